@@ -0,0 +1,11 @@
+#version 330 core
+
+in vec2 uv;
+flat in float layer;
+out vec4 fragColor;
+
+uniform sampler2DArray texture0;
+
+void main() {
+    fragColor = texture(texture0, vec3(uv.x, 1.0 - uv.y, layer));
+}
@@ -0,0 +1,15 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aUv;
+layout (location = 2) in mat4 aTransform;
+layout (location = 6) in float aLayer;
+
+out vec2 uv;
+flat out float layer;
+
+void main() {
+    uv = aUv;
+    layer = aLayer;
+    gl_Position = aTransform * vec4(aPos.x, aPos.y, aPos.z, 1.0);
+}
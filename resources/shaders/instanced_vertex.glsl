@@ -0,0 +1,12 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aUv;
+layout (location = 2) in mat4 aTransform;
+
+out vec2 uv;
+
+void main() {
+    uv = aUv;
+    gl_Position = aTransform * vec4(aPos.x, aPos.y, aPos.z, 1.0);
+}
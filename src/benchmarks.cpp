@@ -0,0 +1,696 @@
+#include "benchmarks.hpp"
+#include "logging.hpp"
+#include "math/transform_kernels.hpp"
+#include "nodes/node.hpp"
+#include "nodes/node_pool.hpp"
+#include "nodes/transform_store.hpp"
+#include "resources/asset_archive.hpp"
+#include "resources/raw_resource.hpp"
+#include "threading/thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace scenegraphdemo {
+    // Children per node of the synthetic trees.
+    static const std::size_t BENCHMARK_FANOUT = 8;
+
+    // Nodes in the synthetic trees unless a size is given.
+    static const std::size_t DEFAULT_BENCHMARK_NODES = 100000;
+
+    // Messages per iteration of the logger benchmark unless a size is given.
+    static const std::size_t DEFAULT_BENCHMARK_MESSAGES = 100000;
+
+    // Messages logged between flushes by the logger benchmark, few enough to
+    // fit in the log queue.
+    static const std::size_t BENCHMARK_LOG_BURST = 1024;
+
+    // Writes a message the way the logger did before it had a queue,
+    // formatting it on the calling thread and flushing every line.
+    static void writeReferenceLog(std::string label, std::string message) {
+        std::cout << "[" << label << "] - " << message << std::endl;
+    }
+
+    // Node as it was before transforms moved into a TransformStore, kept as
+    // the baseline benchmarks are measured against. Children are owned
+    // through shared_ptr, the parent is locked on every rebuild and the local
+    // transform is built from five matrix multiplies.
+    class ReferenceNode : public std::enable_shared_from_this<ReferenceNode> {
+    public:
+        std::weak_ptr<ReferenceNode> parent;
+        std::vector<std::shared_ptr<ReferenceNode>> children;
+        std::string name;
+
+        // Whether destroying the node logs its removal, as every node did.
+        bool logRemoval = false;
+
+        ReferenceNode(std::string name, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale) {
+            this->name = name;
+            this->position = position;
+            this->rotation = rotation;
+            this->scale = scale;
+        }
+
+        virtual ~ReferenceNode() {
+            if (logRemoval) {
+                writeReferenceLog("DEBUG", "Removing Node \"" + name + "\"");
+            }
+        }
+
+        void add(std::shared_ptr<ReferenceNode> node) {
+            node->parent = shared_from_this();
+            node->dirty = true;
+            children.push_back(node);
+        }
+
+        virtual void updateWorldTransform() {
+            if (dirty) {
+                auto parent = this->parent.lock();
+                this->updateLocalTransform();
+                if (parent.get() != nullptr) {
+                    worldTransform = parent.get()->worldTransform * localTransform;
+                } else {
+                    worldTransform = glm::mat4(1.0f) * localTransform;
+                }
+
+                dirty = false;
+                for (auto node : children) {
+                    node.get()->dirty = true;
+                    node.get()->updateWorldTransform();
+                }
+            } else {
+                for (auto node : children) {
+                    node.get()->updateWorldTransform();
+                }
+            }
+        }
+
+        virtual void updateLocalTransform() {
+            auto transform = glm::mat4(1.0f);
+            transform = glm::translate(transform, position);
+            transform = glm::rotate(transform, rotation.y, glm::vec3(0.0, 1.0, 0.0));
+            transform = glm::rotate(transform, rotation.x, glm::vec3(1.0, 0.0, 0.0));
+            transform = glm::rotate(transform, rotation.z, glm::vec3(0.0, 0.0, 1.0));
+            transform = glm::scale(transform, scale);
+            localTransform = transform;
+        }
+
+        const glm::mat4 &getWorldTransform() const {
+            return worldTransform;
+        }
+
+        void setPos(glm::vec3 position) {
+            dirty = true;
+            this->position = position;
+        }
+
+        void setRot(glm::vec3 rotation) {
+            dirty = true;
+            this->rotation = rotation;
+        }
+    private:
+        glm::vec3 position;
+        glm::vec3 rotation;
+        glm::vec3 scale;
+        glm::mat4 localTransform = glm::mat4(1.0f);
+        glm::mat4 worldTransform = glm::mat4(1.0f);
+        bool dirty = true;
+    };
+
+    // Random local transform of a node in a synthetic tree.
+    struct BenchmarkTransform {
+        glm::vec3 position;
+        glm::vec3 rotation;
+    };
+
+    // Generates the transforms of a synthetic tree. The same seed always
+    // gives the same tree.
+    static std::vector<BenchmarkTransform> generateTransforms(std::size_t count) {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> angle(-glm::pi<float>(), glm::pi<float>());
+        std::vector<BenchmarkTransform> transforms(count);
+        for (auto &transform : transforms) {
+            transform.position = glm::vec3(offset(random), offset(random), offset(random));
+            transform.rotation = glm::vec3(angle(random), angle(random), angle(random));
+        }
+        return transforms;
+    }
+
+    // Returns the parent of node i of a synthetic tree, which is laid out
+    // breadth-first with node 0 at the root.
+    static std::size_t benchmarkParentOf(std::size_t i) {
+        return (i - 1) / BENCHMARK_FANOUT;
+    }
+
+    // Runs a function once untimed to settle caches and lazy layouts, then
+    // returns the average number of milliseconds it takes over a number of
+    // iterations. The function is passed the iteration, counting from 1.
+    template <typename F>
+    static double timeIterations(std::size_t iterations, F function) {
+        function(0);
+        iterations = std::max<std::size_t>(iterations, 1);
+        const auto begin = std::chrono::steady_clock::now();
+        for (std::size_t i = 1; i <= iterations; i++) {
+            function(i);
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() /
+            iterations;
+    }
+
+    // Returns the largest difference between two matrices' elements.
+    static float maxDifference(const glm::mat4 &a, const glm::mat4 &b) {
+        float difference = 0.0f;
+        for (int column = 0; column < 4; column++) {
+            for (int row = 0; row < 4; row++) {
+                difference = std::max(difference, std::abs(a[column][row] - b[column][row]));
+            }
+        }
+        return difference;
+    }
+
+    // Counts the nodes of a tree the way every traversal did before nodes
+    // were pooled, copying each child's shared_ptr.
+    static std::size_t countNodes(const std::shared_ptr<ReferenceNode> &node) {
+        std::size_t count = 1;
+        for (auto child : node->children) {
+            count += countNodes(child);
+        }
+        return count;
+    }
+
+    // Counts the nodes of a pooled tree.
+    static std::size_t countNodes(const Node *node) {
+        std::size_t count = 1;
+        for (auto child : node->children) {
+            count += countNodes(child);
+        }
+        return count;
+    }
+
+    // Returns the milliseconds elapsed since begin and moves begin to now.
+    static double lap(std::chrono::steady_clock::time_point &begin) {
+        const auto now = std::chrono::steady_clock::now();
+        const double elapsed = std::chrono::duration<double, std::milli>(now - begin).count();
+        begin = now;
+        return elapsed;
+    }
+
+    // Returns the number of bytes of memory the process has resident, or zero
+    // where /proc isn't available.
+    static std::size_t residentBytes() {
+        std::ifstream statm("/proc/self/statm");
+        std::size_t size = 0;
+        std::size_t resident = 0;
+        if (!(statm >> size >> resident)) {
+            return 0;
+        }
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+
+    // Loads every file of an asset set as the demo does at startup, adding
+    // the milliseconds spent opening them and touching every page of them,
+    // and returns a checksum of the pages touched.
+    static std::uint64_t loadAssets(const std::vector<std::string> &paths, double &open, double &read) {
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<std::unique_ptr<RawResource>> files;
+        for (const auto &path : paths) {
+            files.emplace_back(new RawResource(path, RawResourceMode::MAP));
+        }
+        open += lap(begin);
+
+        std::uint64_t checksum = 0;
+        for (const auto &file : files) {
+            for (std::size_t i = 0; i < file->size(); i += 4096) {
+                checksum += static_cast<unsigned char>(file->data()[i]);
+            }
+        }
+        read += lap(begin);
+        return checksum;
+    }
+
+    bool runBenchmark(const std::string &name, const BenchmarkOptions &options) {
+        if (name == "sweep") {
+            benchmarkTransformSweep(options);
+        } else if (name == "kernels") {
+            benchmarkTransformKernels(options);
+        } else if (name == "spawn") {
+            benchmarkNodeSpawn(options);
+        } else if (name == "logger") {
+            benchmarkLogger(options);
+        } else if (name == "files") {
+            benchmarkFileLoading(options);
+        } else if (name == "archive") {
+            benchmarkArchiveLoading(options);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    void benchmarkTransformSweep(const BenchmarkOptions &options) {
+        const std::size_t count = std::max<std::size_t>(options.size > 0 ? options.size : DEFAULT_BENCHMARK_NODES, 1);
+        const std::size_t grainSize = options.grainSize > 0 ? options.grainSize : TransformStore::DEFAULT_GRAIN_SIZE;
+        std::unique_ptr<ThreadPool> ownPool;
+        ThreadPool *pool = options.pool;
+        if (pool == nullptr) {
+            ownPool.reset(new ThreadPool());
+            pool = ownPool.get();
+        }
+
+        const std::vector<BenchmarkTransform> transforms = generateTransforms(count);
+        NodePool nodes;
+        std::vector<Node *> pooled(count);
+        std::vector<std::shared_ptr<ReferenceNode>> reference(count);
+        for (std::size_t i = 0; i < count; i++) {
+            const BenchmarkTransform &transform = transforms[i];
+            pooled[i] = nodes.create<Node>("sweep", transform.position, transform.rotation, VEC3_ONE);
+            reference[i] = std::make_shared<ReferenceNode>("sweep", transform.position, transform.rotation,
+                VEC3_ONE);
+            if (i > 0) {
+                pooled[benchmarkParentOf(i)]->add(pooled[i]);
+                reference[benchmarkParentOf(i)]->add(reference[i]);
+            }
+        }
+        Node *root = pooled[0];
+        ReferenceNode *referenceRoot = reference[0].get();
+
+        // Full updates turn the root, so every node is rebuilt.
+        auto turnRoot = [&](std::size_t iteration) {
+            return glm::vec3(0.0f, 0.01f * iteration, 0.0f);
+        };
+        const double fullSerial = timeIterations(options.iterations, [&](std::size_t iteration) {
+            root->setRot(turnRoot(iteration));
+            root->updateWorldTransform();
+        });
+        const double fullParallel = timeIterations(options.iterations, [&](std::size_t iteration) {
+            root->setRot(turnRoot(iteration));
+            root->updateWorldTransform(*pool, grainSize);
+        });
+        const double fullRecursive = timeIterations(options.iterations, [&](std::size_t iteration) {
+            referenceRoot->setRot(turnRoot(iteration));
+            referenceRoot->updateWorldTransform();
+        });
+        scenegraphdemo::info("Full update of ", count, " nodes: ", fullRecursive, " ms recursive, ",
+            fullSerial, " ms serial (", fullRecursive / fullSerial, "x), ", fullParallel, " ms on ",
+            pool->size(), " threads (", fullRecursive / fullParallel, "x)");
+
+        // Sparse updates move every hundredth node, starting from a different
+        // one each iteration.
+        const std::size_t stride = 100;
+        auto moveNode = [&](std::size_t iteration, std::size_t i) {
+            return transforms[i].position + glm::vec3(0.001f * iteration, 0.0f, 0.0f);
+        };
+        const double sparseSerial = timeIterations(options.iterations, [&](std::size_t iteration) {
+            for (std::size_t i = iteration % stride; i < count; i += stride) {
+                pooled[i]->setPos(moveNode(iteration, i));
+            }
+            root->updateWorldTransform();
+        });
+        const double sparseParallel = timeIterations(options.iterations, [&](std::size_t iteration) {
+            for (std::size_t i = iteration % stride; i < count; i += stride) {
+                pooled[i]->setPos(moveNode(iteration, i));
+            }
+            root->updateWorldTransform(*pool, grainSize);
+        });
+        const double sparseRecursive = timeIterations(options.iterations, [&](std::size_t iteration) {
+            for (std::size_t i = iteration % stride; i < count; i += stride) {
+                reference[i]->setPos(moveNode(iteration, i));
+            }
+            referenceRoot->updateWorldTransform();
+        });
+        scenegraphdemo::info("Sparse update of ", (count + stride - 1) / stride, " of ", count, " nodes: ",
+            sparseRecursive, " ms recursive, ", sparseSerial, " ms serial (", sparseRecursive / sparseSerial,
+            "x), ", sparseParallel, " ms on ", pool->size(), " threads (", sparseRecursive / sparseParallel,
+            "x)");
+
+        // Every path ran the same iterations, so they must agree up to the
+        // rounding of the different ways they build local transforms.
+        float difference = 0.0f;
+        for (std::size_t i = 0; i < count; i++) {
+            difference = std::max(difference,
+                maxDifference(pooled[i]->getWorldTransform(), reference[i]->getWorldTransform()));
+        }
+        scenegraphdemo::info("Store and recursive world transforms differ by at most ", difference);
+    }
+
+    void benchmarkTransformKernels(const BenchmarkOptions &options) {
+        const std::size_t count = std::max<std::size_t>(options.size > 0 ? options.size : DEFAULT_BENCHMARK_NODES, 1);
+        const std::vector<BenchmarkTransform> transforms = generateTransforms(count);
+        std::vector<glm::quat> orientations(count);
+        for (std::size_t i = 0; i < count; i++) {
+            orientations[i] = orientationFromEuler(transforms[i].rotation);
+        }
+        const glm::vec3 scale(1.0f, 2.0f, 0.5f);
+        std::vector<glm::mat4> composed(count);
+        std::vector<glm::mat4> expected(count);
+
+        const double composeKernel = timeIterations(options.iterations, [&](std::size_t) {
+            for (std::size_t i = 0; i < count; i++) {
+                composed[i] = composeTransform(transforms[i].position, orientations[i], scale);
+            }
+        });
+        const double composeGlm = timeIterations(options.iterations, [&](std::size_t) {
+            for (std::size_t i = 0; i < count; i++) {
+                const glm::vec3 &rotation = transforms[i].rotation;
+                auto transform = glm::translate(glm::mat4(1.0f), transforms[i].position);
+                transform = glm::rotate(transform, rotation.y, glm::vec3(0.0, 1.0, 0.0));
+                transform = glm::rotate(transform, rotation.x, glm::vec3(1.0, 0.0, 0.0));
+                transform = glm::rotate(transform, rotation.z, glm::vec3(0.0, 0.0, 1.0));
+                expected[i] = glm::scale(transform, scale);
+            }
+        });
+        float composeDifference = 0.0f;
+        for (std::size_t i = 0; i < count; i++) {
+            composeDifference = std::max(composeDifference, maxDifference(composed[i], expected[i]));
+        }
+        scenegraphdemo::info("Composing ", count, " local transforms: ", composeGlm * 1e6 / count,
+            " ns each with glm, ", composeKernel * 1e6 / count, " ns each with composeTransform (",
+            composeGlm / composeKernel, "x), differing by at most ", composeDifference);
+
+        // The composed transforms stand in for world transforms a view
+        // projection matrix is applied to.
+        const glm::mat4 lhs = expected[0];
+        std::vector<glm::mat4> products(count);
+        const double multiplyKernel = timeIterations(options.iterations, [&](std::size_t) {
+            multiplyTransforms(lhs, composed.data(), products.data(), count);
+        });
+        const double multiplyGlm = timeIterations(options.iterations, [&](std::size_t) {
+            for (std::size_t i = 0; i < count; i++) {
+                expected[i] = lhs * composed[i];
+            }
+        });
+        float multiplyDifference = 0.0f;
+        for (std::size_t i = 0; i < count; i++) {
+            multiplyDifference = std::max(multiplyDifference, maxDifference(products[i], expected[i]));
+        }
+        scenegraphdemo::info("Multiplying ", count, " transforms: ", multiplyGlm * 1e6 / count,
+            " ns each with glm, ", multiplyKernel * 1e6 / count, " ns each with ", transformKernelIsa(),
+            " multiplyTransforms (", multiplyGlm / multiplyKernel, "x), differing by at most ",
+            multiplyDifference);
+    }
+
+    void benchmarkNodeSpawn(const BenchmarkOptions &options) {
+        const std::size_t count = std::max<std::size_t>(options.size > 0 ? options.size : DEFAULT_BENCHMARK_NODES, 1);
+        const std::size_t iterations = std::max<std::size_t>(options.iterations, 1);
+        const std::vector<BenchmarkTransform> transforms = generateTransforms(count);
+
+        // The pool is reused across iterations, so after the first one its
+        // arenas already hold enough memory.
+        NodePool nodes;
+        std::vector<Node *> pooled(count);
+        double pooledSpawn = 0.0;
+        double pooledWalk = 0.0;
+        double pooledTeardown = 0.0;
+        std::size_t pooledCount = 0;
+        for (std::size_t iteration = 0; iteration <= iterations; iteration++) {
+            auto begin = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < count; i++) {
+                pooled[i] = nodes.create<Node>("spawn", transforms[i].position, transforms[i].rotation, VEC3_ONE);
+                if (i > 0) {
+                    pooled[benchmarkParentOf(i)]->add(pooled[i]);
+                }
+            }
+            const double spawn = lap(begin);
+            pooledCount = countNodes(pooled[0]);
+            const double walk = lap(begin);
+            nodes.clear();
+            const double teardown = lap(begin);
+
+            // Released transform slots are compacted by the next sweep, as
+            // they would be by the next frame's update.
+            TransformStore::getDefault()->updateWorldTransforms();
+
+            // The first iteration warms up and isn't counted.
+            if (iteration > 0) {
+                pooledSpawn += spawn;
+                pooledWalk += walk;
+                pooledTeardown += teardown;
+            }
+        }
+
+        std::vector<std::shared_ptr<ReferenceNode>> reference(count);
+        double referenceSpawn = 0.0;
+        double referenceWalk = 0.0;
+        double referenceTeardown = 0.0;
+        std::size_t referenceCount = 0;
+        for (std::size_t iteration = 0; iteration <= iterations; iteration++) {
+            auto begin = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < count; i++) {
+                reference[i] = std::make_shared<ReferenceNode>("spawn", transforms[i].position,
+                    transforms[i].rotation, VEC3_ONE);
+                if (i > 0) {
+                    reference[benchmarkParentOf(i)]->add(reference[i]);
+                }
+            }
+            // Only the root is held on to, as a scene would.
+            std::shared_ptr<ReferenceNode> root = reference[0];
+            std::fill(reference.begin(), reference.end(), nullptr);
+            const double spawn = lap(begin);
+            referenceCount = countNodes(root);
+            const double walk = lap(begin);
+            root.reset();
+            const double teardown = lap(begin);
+
+            if (iteration > 0) {
+                referenceSpawn += spawn;
+                referenceWalk += walk;
+                referenceTeardown += teardown;
+            }
+        }
+
+        if (pooledCount != count || referenceCount != count) {
+            scenegraphdemo::error("Spawned trees hold ", pooledCount, " and ", referenceCount, " nodes instead of ",
+                count);
+        }
+        const double perNode = 1e6 / (static_cast<double>(iterations) * count);
+        scenegraphdemo::info("Spawning ", count, " nodes: ", referenceSpawn * perNode, " ns each with make_shared, ",
+            pooledSpawn * perNode, " ns each from a pool (", referenceSpawn / pooledSpawn, "x)");
+        scenegraphdemo::info("Walking ", count, " nodes: ", referenceWalk * perNode,
+            " ns each through shared_ptr children, ", pooledWalk * perNode, " ns each through pointers (",
+            referenceWalk / pooledWalk, "x)");
+        scenegraphdemo::info("Tearing down ", count, " nodes: ", referenceTeardown * perNode,
+            " ns each by releasing the root, ", pooledTeardown * perNode, " ns each by clearing the pool (",
+            referenceTeardown / pooledTeardown, "x)");
+    }
+
+    void benchmarkLogger(const BenchmarkOptions &options) {
+        const std::size_t count = std::max<std::size_t>(options.size > 0 ? options.size : DEFAULT_BENCHMARK_MESSAGES, 1);
+        const double perMessage = 1e6 / count;
+        const LogLevel level = getLogLevel();
+        if (!isLogEnabled(LogLevel::INFO)) {
+            scenegraphdemo::warn("Info messages are disabled, so only filtered calls are timed");
+        }
+        flushLog();
+
+        setLogLevel(LogLevel::WARN);
+        const double filtered = timeIterations(options.iterations, [&](std::size_t) {
+            for (std::size_t i = 0; i < count; i++) {
+                scenegraphdemo::info("Benchmark message ", i, " of ", count);
+            }
+        });
+
+        // Calls only queue messages, so the flushes that wait for the writer
+        // are timed on their own. Messages are logged in bursts that fit in
+        // the queue, as messages that don't are dropped.
+        setLogLevel(LogLevel::INFO);
+        const std::size_t droppedBefore = getDroppedLogMessages();
+        double queued = 0.0;
+        double written = 0.0;
+        timeIterations(options.iterations, [&](std::size_t iteration) {
+            double calls = 0.0;
+            double flushes = 0.0;
+            for (std::size_t first = 0; first < count; first += BENCHMARK_LOG_BURST) {
+                auto begin = std::chrono::steady_clock::now();
+                for (std::size_t i = first; i < std::min(first + BENCHMARK_LOG_BURST, count); i++) {
+                    scenegraphdemo::info("Benchmark message ", i, " of ", count);
+                }
+                calls += lap(begin);
+                flushLog();
+                flushes += lap(begin);
+            }
+            if (iteration > 0) {
+                queued += calls;
+                written += flushes;
+            }
+        });
+        const std::size_t dropped = getDroppedLogMessages() - droppedBefore;
+        queued /= std::max<std::size_t>(options.iterations, 1);
+        written /= std::max<std::size_t>(options.iterations, 1);
+
+        const double synchronous = timeIterations(options.iterations, [&](std::size_t) {
+            for (std::size_t i = 0; i < count; i++) {
+                writeReferenceLog("INFO", "Benchmark message " + std::to_string(i) + " of " + std::to_string(count));
+            }
+        });
+
+        // Every node logs its removal at debug level.
+        setLogLevel(LogLevel::DEBUG);
+        double teardown = 0.0;
+        double teardownFlushed = 0.0;
+        const std::size_t teardownDroppedBefore = getDroppedLogMessages();
+        {
+            NodePool nodes;
+            std::vector<Node *> pooled(count);
+            for (std::size_t i = 0; i < count; i++) {
+                pooled[i] = nodes.create<Node>("teardown");
+                if (i > 0) {
+                    pooled[benchmarkParentOf(i)]->add(pooled[i]);
+                }
+            }
+            auto begin = std::chrono::steady_clock::now();
+            nodes.clear();
+            teardown = lap(begin);
+            flushLog();
+            teardownFlushed = teardown + lap(begin);
+        }
+        const std::size_t teardownDropped = getDroppedLogMessages() - teardownDroppedBefore;
+        double referenceTeardown = 0.0;
+        {
+            std::vector<std::shared_ptr<ReferenceNode>> reference(count);
+            for (std::size_t i = 0; i < count; i++) {
+                reference[i] = std::make_shared<ReferenceNode>("teardown", VEC3_ZERO, VEC3_ZERO, VEC3_ONE);
+                reference[i]->logRemoval = true;
+                if (i > 0) {
+                    reference[benchmarkParentOf(i)]->add(reference[i]);
+                }
+            }
+            std::shared_ptr<ReferenceNode> root = reference[0];
+            std::fill(reference.begin(), reference.end(), nullptr);
+            auto begin = std::chrono::steady_clock::now();
+            root.reset();
+            referenceTeardown = lap(begin);
+        }
+
+        setLogLevel(LogLevel::INFO);
+        scenegraphdemo::info("Logging ", count, " messages: ", filtered * perMessage, " ns per filtered call, ",
+            queued * perMessage, " ns per queued call plus ", written * perMessage, " ns to write it (", dropped,
+            " dropped), ", synchronous * perMessage, " ns per synchronous call");
+        scenegraphdemo::info("Tearing down ", count, " logging nodes: ", teardown, " ms from a pool, ",
+            teardownFlushed, " ms until written (", teardownDropped, " messages dropped), ", referenceTeardown,
+            " ms with synchronous logging");
+        flushLog();
+        setLogLevel(level);
+    }
+
+    void benchmarkFileLoading(const BenchmarkOptions &options) {
+        if (options.file.empty()) {
+            scenegraphdemo::error("The file benchmark needs a file to load");
+            return;
+        }
+
+        const RawResourceMode modes[] = {RawResourceMode::READ, RawResourceMode::MAP};
+        double times[2];
+        std::size_t growth[2] = {0, 0};
+        std::uint64_t checksums[2] = {0, 0};
+        std::size_t size = 0;
+        try {
+            for (int m = 0; m < 2; m++) {
+                times[m] = timeIterations(options.iterations, [&](std::size_t) {
+                    const std::size_t before = residentBytes();
+                    RawResource file(options.file, modes[m]);
+
+                    // Every page is touched, as by a consumer of the whole file.
+                    std::uint64_t checksum = 0;
+                    for (std::size_t i = 0; i < file.size(); i += 4096) {
+                        checksum += static_cast<unsigned char>(file.data()[i]);
+                    }
+                    const std::size_t after = residentBytes();
+                    growth[m] = std::max(growth[m], after > before ? after - before : 0);
+                    checksums[m] = checksum;
+                    size = file.size();
+                });
+            }
+        } catch (const std::runtime_error &e) {
+            scenegraphdemo::error("Cannot benchmark loading ", options.file, ": ", e.what());
+            return;
+        }
+
+        if (checksums[0] != checksums[1]) {
+            scenegraphdemo::error("Read and mapped contents of ", options.file, " differ");
+        }
+        const double megabytes = 1.0 / (1024 * 1024);
+        scenegraphdemo::info("Loading ", options.file, " (", size * megabytes, " MB): ", times[0],
+            " ms read taking ", growth[0] * megabytes, " MB resident, ", times[1], " ms mapped taking ",
+            growth[1] * megabytes, " MB resident shared with the page cache (", times[0] / times[1], "x)");
+    }
+
+    void benchmarkArchiveLoading(const BenchmarkOptions &options) {
+        if (options.file.empty() || options.directory.empty()) {
+            scenegraphdemo::error("The archive benchmark needs an archive and the directory it was packed from");
+            return;
+        }
+
+        // The asset set is every file in the archive, which is only opened
+        // here to list them.
+        std::vector<std::string> paths;
+        try {
+            AssetArchive archive(options.file);
+            for (const auto &entry : archive.getEntries()) {
+                paths.push_back(options.directory + "/" + archive.getPath(entry));
+            }
+        } catch (const std::runtime_error &e) {
+            scenegraphdemo::error("Cannot benchmark loading ", options.file, ": ", e.what());
+            return;
+        }
+
+        const std::size_t iterations = std::max<std::size_t>(options.iterations, 1);
+        double looseOpen = 0.0;
+        double looseRead = 0.0;
+        double archiveOpen = 0.0;
+        double archiveRead = 0.0;
+        std::uint64_t looseChecksum = 0;
+        std::uint64_t archiveChecksum = 0;
+        try {
+            // The first iteration of each warms up and isn't counted.
+            for (std::size_t iteration = 0; iteration <= iterations; iteration++) {
+                double open = 0.0;
+                double read = 0.0;
+                looseChecksum = loadAssets(paths, open, read);
+                if (iteration > 0) {
+                    looseOpen += open;
+                    looseRead += read;
+                }
+            }
+
+            // Opening and mounting the archive is part of its startup cost.
+            for (std::size_t iteration = 0; iteration <= iterations; iteration++) {
+                double open = 0.0;
+                double read = 0.0;
+                auto begin = std::chrono::steady_clock::now();
+                mountArchive(std::make_shared<AssetArchive>(options.file), options.directory);
+                open += lap(begin);
+                archiveChecksum = loadAssets(paths, open, read);
+                unmountArchives();
+                if (iteration > 0) {
+                    archiveOpen += open;
+                    archiveRead += read;
+                }
+            }
+        } catch (const std::runtime_error &e) {
+            unmountArchives();
+            scenegraphdemo::error("Cannot benchmark loading ", options.file, ": ", e.what());
+            return;
+        }
+
+        if (looseChecksum != archiveChecksum) {
+            scenegraphdemo::error("Loose files and ", options.file, " hold different contents");
+        }
+        scenegraphdemo::info("Loading ", paths.size(), " loose files: ", looseOpen / iterations, " ms opening, ",
+            looseRead / iterations, " ms reading");
+        scenegraphdemo::info("Loading ", paths.size(), " files from ", options.file, ": ", archiveOpen / iterations,
+            " ms opening (", looseOpen / archiveOpen, "x), ", archiveRead / iterations, " ms reading (",
+            looseRead / archiveRead, "x)");
+    }
+}
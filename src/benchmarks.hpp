@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace scenegraphdemo {
+    class ThreadPool;
+
+    // Workload of a headless benchmark.
+    struct BenchmarkOptions {
+        // Number of nodes or matrices each iteration works on, or zero for
+        // the benchmark's default.
+        std::size_t size = 0;
+
+        // Number of timed iterations.
+        std::size_t iterations = 1;
+
+        // Pool used by parallel variants, or nullptr to use one worker per
+        // hardware thread.
+        ThreadPool *pool = nullptr;
+
+        // Minimum number of transform slots per task of parallel updates, or
+        // zero for TransformStore::DEFAULT_GRAIN_SIZE.
+        std::size_t grainSize = 0;
+
+        // File loaded by the file benchmark, or archive loaded by the archive
+        // benchmark.
+        std::string file;
+
+        // Directory the archive benchmark's archive was packed from.
+        std::string directory;
+    };
+
+    // Runs the benchmark with the given name and logs its results. Returns
+    // false if there's no such benchmark.
+    bool runBenchmark(const std::string &name, const BenchmarkOptions &options);
+
+    // Times world transform updates of a synthetic tree through the transform
+    // store, serially and on a thread pool, against the recursive update over
+    // shared_ptr children that the store replaced. Both a full update, where
+    // the root moves, and a sparse one, where 1% of the nodes move, are
+    // measured, and the results of both paths are compared.
+    void benchmarkTransformSweep(const BenchmarkOptions &options);
+
+    // Times the matrix kernels against the glm code they replaced: building
+    // local transforms with composeTransform instead of translate, rotate and
+    // scale, and multiplying batches with multiplyTransforms instead of
+    // glm's operator*.
+    void benchmarkTransformKernels(const BenchmarkOptions &options);
+
+    // Times spawning a synthetic tree from a NodePool, walking it and tearing
+    // it down in bulk, against the make_shared nodes with shared_ptr children
+    // that the pool replaced.
+    void benchmarkNodeSpawn(const BenchmarkOptions &options);
+
+    // Times log calls that are filtered out, log calls that are queued and
+    // the writes behind them, and tearing down a tree while every node logs
+    // its removal, against the synchronous std::cout logging the queue
+    // replaced. Writes every message it times, so output is best discarded.
+    void benchmarkLogger(const BenchmarkOptions &options);
+
+    // Times loading a file through a RawResource read into memory against
+    // one mapped into memory, touching every page of it, and measures how
+    // much resident memory each takes. The file is in the page cache after
+    // the untimed first load.
+    void benchmarkFileLoading(const BenchmarkOptions &options);
+
+    // Times loading every file of an asset archive from the directory it was
+    // packed from against loading them through the mounted archive, split
+    // into opening the files and touching every page of them. Opening the
+    // archive counts towards its files' opening time. The files are in the
+    // page cache after the untimed first load.
+    void benchmarkArchiveLoading(const BenchmarkOptions &options);
+}
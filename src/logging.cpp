@@ -1,27 +1,297 @@
 #include "logging.hpp"
-#include <iostream>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 namespace scenegraphdemo {
-    // Logs a message of a specified log level to stdout.
-    void log(std::string label, std::string message) {
-        std::cout << "[" << label << "] - " << message << std::endl;
+    // Number of records in the queue. Must be a power of two.
+    const std::size_t LOG_QUEUE_SIZE = 4096;
+
+    // Longest the writer sleeps before looking for records again, which
+    // bounds the delay of a wakeup that raced with it falling asleep.
+    const std::chrono::milliseconds LOG_WRITER_SLEEP(10);
+
+    // Returns the level named by the SCENEGRAPHDEMO_LOG_LEVEL environment
+    // variable, or INFO if it's unset or unknown.
+    static int initialLogLevel() {
+        const char *name = std::getenv("SCENEGRAPHDEMO_LOG_LEVEL");
+        if (name == nullptr) {
+            return static_cast<int>(LogLevel::INFO);
+        }
+        const std::string level = name;
+        if (level == "debug") {
+            return static_cast<int>(LogLevel::DEBUG);
+        } else if (level == "warn") {
+            return static_cast<int>(LogLevel::WARN);
+        } else if (level == "error") {
+            return static_cast<int>(LogLevel::ERROR);
+        } else if (level == "none") {
+            return static_cast<int>(LogLevel::NONE);
+        } else {
+            return static_cast<int>(LogLevel::INFO);
+        }
+    }
+
+    std::atomic<int> runtimeLogLevel{initialLogLevel()};
+
+    void setLogLevel(LogLevel level) {
+        runtimeLogLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    LogLevel getLogLevel() {
+        return static_cast<LogLevel>(runtimeLogLevel.load(std::memory_order_relaxed));
     }
 
-    // Ad-hoc log functions.
+    // Returns the label messages of a level are written with.
+    static const char *labelOf(LogLevel level) {
+        switch (level) {
+        case LogLevel::DEBUG:
+            return "DEBUG";
+        case LogLevel::INFO:
+            return "INFO";
+        case LogLevel::WARN:
+            return "WARN";
+        case LogLevel::ERROR:
+            return "ERROR";
+        default:
+            return "LOG";
+        }
+    }
+
+    // Bounded queue of records with a background thread writing them to
+    // stdout. Claiming a record follows Dmitry Vyukov's bounded MPMC queue:
+    // each record's sequence says whose turn it is, so producers only race
+    // on a single compare-and-swap of the enqueue position and never wait on
+    // each other or on the writer. There's only one consumer, so dequeuing
+    // needs no atomics beyond the sequences.
+    class LogWriter {
+    public:
+        LogWriter() : records(new LogRecord[LOG_QUEUE_SIZE]) {
+            for (std::size_t i = 0; i < LOG_QUEUE_SIZE; i++) {
+                records[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            thread = std::thread([this] {
+                run();
+            });
+        }
+
+        // Writes every remaining message before returning.
+        ~LogWriter() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+
+        LogRecord *claim(LogLevel level) {
+            std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+            while (true) {
+                LogRecord &record = records[position & (LOG_QUEUE_SIZE - 1)];
+                const std::size_t sequence = record.sequence.load(std::memory_order_acquire);
+                const std::ptrdiff_t difference =
+                    static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+                if (difference == 0) {
+                    if (enqueuePosition.compare_exchange_weak(position, position + 1,
+                            std::memory_order_relaxed)) {
+                        record.level = level;
+                        return &record;
+                    }
+                } else if (difference < 0) {
+                    // The writer hasn't freed this record yet. Only debug and
+                    // info messages are worth losing to avoid waiting.
+                    if (level < LogLevel::WARN) {
+                        dropped.fetch_add(1, std::memory_order_relaxed);
+                        return nullptr;
+                    }
+                    wake.notify_one();
+                    std::this_thread::yield();
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+                } else {
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void publish(LogRecord *record) {
+            // The claimed position is the sequence the record had when it was
+            // claimed, which is one less than it is once published.
+            const std::size_t position = record->sequence.load(std::memory_order_relaxed);
+            record->sequence.store(position + 1, std::memory_order_release);
+            if (sleeping.load(std::memory_order_relaxed)) {
+                wake.notify_one();
+            }
+        }
+
+        void flush() {
+            const std::size_t target = enqueuePosition.load(std::memory_order_relaxed);
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.notify_one();
+            drained.wait(lock, [this, target] {
+                return written.load(std::memory_order_acquire) >= target;
+            });
+        }
+
+        std::size_t getDropped() const {
+            return dropped.load(std::memory_order_relaxed);
+        }
+    private:
+        std::unique_ptr<LogRecord[]> records;
+        std::atomic<std::size_t> enqueuePosition{0};
+
+        // Position of the next record to write, only used by the writer.
+        std::size_t dequeuePosition = 0;
+
+        // Number of records written so far, for flush.
+        std::atomic<std::size_t> written{0};
+
+        std::atomic<std::size_t> dropped{0};
+        std::size_t reportedDropped = 0;
+
+        // Guards stopping and the writer's sleep.
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable drained;
+        std::atomic<bool> sleeping{false};
+        bool stopping = false;
+
+        std::thread thread;
+
+        // Text of the records being written, reused between batches.
+        std::string buffer;
+
+        void run() {
+            while (true) {
+                if (drain() > 0) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    drained.notify_all();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(mutex);
+                if (stopping && enqueuePosition.load(std::memory_order_relaxed) == dequeuePosition) {
+                    break;
+                }
+                sleeping.store(true, std::memory_order_relaxed);
+                wake.wait_for(lock, LOG_WRITER_SLEEP);
+                sleeping.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        // Writes out every published record and returns how many there were.
+        std::size_t drain() {
+            std::size_t count = 0;
+            buffer.clear();
+            while (true) {
+                LogRecord &record = records[dequeuePosition & (LOG_QUEUE_SIZE - 1)];
+                if (record.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) {
+                    break;
+                }
+                format(record);
+                record.sequence.store(dequeuePosition + LOG_QUEUE_SIZE, std::memory_order_release);
+                dequeuePosition++;
+                count++;
+            }
+
+            const std::size_t droppedNow = dropped.load(std::memory_order_relaxed);
+            if (droppedNow != reportedDropped) {
+                buffer += "[WARN] - " + std::to_string(droppedNow - reportedDropped) +
+                    " log messages were dropped because the queue was full\n";
+                reportedDropped = droppedNow;
+            }
+
+            if (!buffer.empty()) {
+                std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+                std::fflush(stdout);
+            }
+            written.fetch_add(count, std::memory_order_release);
+            return count;
+        }
+
+        // Appends the text of a record to the buffer.
+        void format(const LogRecord &record) {
+            buffer += '[';
+            buffer += labelOf(record.level);
+            buffer += "] - ";
+
+            const char *payload = record.payload;
+            std::size_t offset = 0;
+            char number[32];
+            while (offset < record.size) {
+                const LogArgument type = static_cast<LogArgument>(payload[offset++]);
+                switch (type) {
+                case LogArgument::STRING: {
+                    std::uint32_t length;
+                    std::memcpy(&length, payload + offset, sizeof(length));
+                    buffer.append(payload + offset + sizeof(length), length);
+                    offset += sizeof(length) + length;
+                    break;
+                }
+                case LogArgument::SIGNED: {
+                    std::int64_t value;
+                    std::memcpy(&value, payload + offset, sizeof(value));
+                    std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(value));
+                    buffer += number;
+                    offset += sizeof(value);
+                    break;
+                }
+                case LogArgument::UNSIGNED: {
+                    std::uint64_t value;
+                    std::memcpy(&value, payload + offset, sizeof(value));
+                    std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(value));
+                    buffer += number;
+                    offset += sizeof(value);
+                    break;
+                }
+                case LogArgument::FLOATING: {
+                    double value;
+                    std::memcpy(&value, payload + offset, sizeof(value));
+                    std::snprintf(number, sizeof(number), "%g", value);
+                    buffer += number;
+                    offset += sizeof(value);
+                    break;
+                }
+                case LogArgument::BOOLEAN: {
+                    bool value;
+                    std::memcpy(&value, payload + offset, sizeof(value));
+                    buffer += value ? "true" : "false";
+                    offset += sizeof(value);
+                    break;
+                }
+                default:
+                    offset = record.size;
+                    break;
+                }
+            }
+            buffer += '\n';
+        }
+    };
+
+    // Started on first use and stopped, after writing what's left, when the
+    // program exits.
+    static LogWriter &getLogWriter() {
+        static LogWriter writer;
+        return writer;
+    }
 
-    void info(std::string message) {
-        log("INFO", message);
+    LogRecord *claimLogRecord(LogLevel level) {
+        return getLogWriter().claim(level);
     }
 
-    void debug(std::string message) {
-        log("DEBUG", message);
+    void publishLogRecord(LogRecord *record) {
+        getLogWriter().publish(record);
     }
 
-    void warn(std::string message) {
-        log("WARN", message);
+    void flushLog() {
+        getLogWriter().flush();
     }
 
-    void error(std::string message) {
-        log("ERROR", message);
+    std::size_t getDroppedLogMessages() {
+        return getLogWriter().getDropped();
     }
 }
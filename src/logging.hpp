@@ -1,15 +1,202 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <type_traits>
+
+// Least severe level that's compiled in at all, as a LogLevel value. Calls
+// below it compile to nothing.
+#ifndef SCENEGRAPHDEMO_LOG_LEVEL
+#define SCENEGRAPHDEMO_LOG_LEVEL 0
+#endif
 
 namespace scenegraphdemo {
-    // Logs a message of a specified log level to stdout.
-    void log(std::string label, std::string message);
+    enum class LogLevel : int {
+        DEBUG = 0,
+        INFO = 1,
+        WARN = 2,
+        ERROR = 3,
+        NONE = 4,
+    };
+
+    // Number of bytes of arguments a single message can hold. Arguments that
+    // don't fit are cut off.
+    const std::size_t LOG_PAYLOAD_SIZE = 240;
+
+    // Message queued for the writer thread. Arguments are stored in their
+    // binary form and only turned into text by the writer, so logging never
+    // allocates or formats on the calling thread.
+    struct LogRecord {
+        // Position of the record in the queue, see the queue's notes in
+        // logging.cpp.
+        std::atomic<std::size_t> sequence;
+
+        LogLevel level;
+        std::uint32_t size;
+        char payload[LOG_PAYLOAD_SIZE];
+    };
+
+    // Type tags preceding every argument in a record's payload.
+    enum class LogArgument : char {
+        STRING = 's',
+        SIGNED = 'i',
+        UNSIGNED = 'u',
+        FLOATING = 'f',
+        BOOLEAN = 'b',
+    };
+
+    // Sets and returns the least severe level that's written. Defaults to
+    // INFO, or the level named by the SCENEGRAPHDEMO_LOG_LEVEL environment
+    // variable ("debug", "info", "warn", "error" or "none").
+    void setLogLevel(LogLevel level);
+    LogLevel getLogLevel();
+
+    // Level that's checked by every log call, kept inline so a disabled call
+    // costs a single load.
+    extern std::atomic<int> runtimeLogLevel;
+
+    // Returns whether messages of a level are written.
+    inline bool isLogEnabled(LogLevel level) {
+        return static_cast<int>(level) >= SCENEGRAPHDEMO_LOG_LEVEL &&
+            static_cast<int>(level) >= runtimeLogLevel.load(std::memory_order_relaxed);
+    }
+
+    // Claims a record in the queue. If the queue is full, debug and info
+    // messages are dropped and counted, returning nullptr, while warnings and
+    // errors wait for the writer to make room.
+    LogRecord *claimLogRecord(LogLevel level);
+
+    // Hands a claimed record to the writer thread.
+    void publishLogRecord(LogRecord *record);
+
+    // Blocks until every message logged so far was written out.
+    void flushLog();
+
+    // Returns the number of messages dropped because the queue was full.
+    std::size_t getDroppedLogMessages();
+
+    // Encodes arguments into a record's payload.
+    class LogRecordBuilder {
+    public:
+        LogRecordBuilder(LogRecord &record) : record(record) {
+            record.size = 0;
+        }
+
+        void append(const char *value) {
+            appendString(value, std::strlen(value));
+        }
+
+        void append(const std::string &value) {
+            appendString(value.data(), value.size());
+        }
+
+        void append(bool value) {
+            appendValue(LogArgument::BOOLEAN, value);
+        }
+
+        void append(char value) {
+            appendString(&value, 1);
+        }
+
+        template<typename T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+        append(T value) {
+            appendValue(LogArgument::SIGNED, static_cast<std::int64_t>(value));
+        }
+
+        template<typename T>
+        typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+        append(T value) {
+            appendValue(LogArgument::UNSIGNED, static_cast<std::uint64_t>(value));
+        }
+
+        template<typename T>
+        typename std::enable_if<std::is_floating_point<T>::value>::type
+        append(T value) {
+            appendValue(LogArgument::FLOATING, static_cast<double>(value));
+        }
+    private:
+        LogRecord &record;
+
+        // Strings are stored as their length followed by their characters.
+        void appendString(const char *value, std::size_t length) {
+            const std::size_t header = 1 + sizeof(std::uint32_t);
+            if (record.size + header > LOG_PAYLOAD_SIZE) {
+                return;
+            }
+            const std::uint32_t stored = static_cast<std::uint32_t>(
+                std::min<std::size_t>(length, LOG_PAYLOAD_SIZE - record.size - header));
+            record.payload[record.size] = static_cast<char>(LogArgument::STRING);
+            std::memcpy(record.payload + record.size + 1, &stored, sizeof(stored));
+            std::memcpy(record.payload + record.size + header, value, stored);
+            record.size += header + stored;
+        }
+
+        template<typename T>
+        void appendValue(LogArgument type, T value) {
+            if (record.size + 1 + sizeof(value) > LOG_PAYLOAD_SIZE) {
+                return;
+            }
+            record.payload[record.size] = static_cast<char>(type);
+            std::memcpy(record.payload + record.size + 1, &value, sizeof(value));
+            record.size += 1 + sizeof(value);
+        }
+    };
+
+    inline void appendLogArguments(LogRecordBuilder &) {
+    }
+
+    template<typename T, typename... Args>
+    void appendLogArguments(LogRecordBuilder &builder, const T &value, const Args &... args) {
+        builder.append(value);
+        appendLogArguments(builder, args...);
+    }
+
+    // Queues a message made of the arguments written one after another. The
+    // arguments are only copied, so passing pieces instead of a concatenated
+    // string keeps disabled levels free. Strings, characters, booleans and
+    // numbers are supported.
+    template<typename... Args>
+    void log(LogLevel level, const Args &... args) {
+        if (!isLogEnabled(level)) {
+            return;
+        }
+        LogRecord *record = claimLogRecord(level);
+        if (record == nullptr) {
+            return;
+        }
+        LogRecordBuilder builder(*record);
+        appendLogArguments(builder, args...);
+        publishLogRecord(record);
+    }
+
+    // Ad-hoc log functions. Errors are flushed before returning, so they
+    // can't be lost if the program dies right after.
+
+    template<typename... Args>
+    void info(const Args &... args) {
+        log(LogLevel::INFO, args...);
+    }
+
+    template<typename... Args>
+    void debug(const Args &... args) {
+        log(LogLevel::DEBUG, args...);
+    }
 
-    // Ad-hoc log functions.
+    template<typename... Args>
+    void warn(const Args &... args) {
+        log(LogLevel::WARN, args...);
+    }
 
-    void info(std::string message);
-    void debug(std::string message);
-    void warn(std::string message);
-    void error(std::string message);
+    template<typename... Args>
+    void error(const Args &... args) {
+        log(LogLevel::ERROR, args...);
+        if (isLogEnabled(LogLevel::ERROR)) {
+            flushLog();
+        }
+    }
 }
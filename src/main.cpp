@@ -1,14 +1,36 @@
+#include "benchmarks.hpp"
 #include "logging.hpp"
+#include "math/transform_kernels.hpp"
+#include "nodes/frustum_culler.hpp"
 #include "nodes/node.hpp"
+#include "nodes/node_pool.hpp"
 #include "nodes/perspective_camera.hpp"
+#include "profiling/profiler.hpp"
+#include "rendering/frame_pipeline.hpp"
+#include "rendering/frame_snapshot.hpp"
+#include "rendering/render_queue.hpp"
+#include "rendering/renderable.hpp"
+#include "resources/asset_archive.hpp"
 #include "resources/image_resource.hpp"
+#include "resources/mesh.hpp"
 #include "resources/raw_resource.hpp"
 #include "resources/resource.hpp"
+#include "resources/resource_cache.hpp"
+#include "resources/texture_array.hpp"
+#include "resources/texture_cache.hpp"
+#include "resources/texture_loader.hpp"
+#include "shaders/program_binary_cache.hpp"
 #include "shaders/shader.hpp"
+#include "threading/thread_pool.hpp"
+#include "timing/fixed_timestep.hpp"
 #include <GL/glew.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
+#include <algorithm>
 #include <boost/filesystem.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <glm/glm.hpp>
@@ -17,6 +39,8 @@
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <string>
+#include <vector>
 
 using namespace scenegraphdemo;
 
@@ -68,6 +92,276 @@ bool handleEvents(SDL_Event *event) {
     return true;
 }
 
+// Number of simulation steps per second unless SCENEGRAPHDEMO_STEP_RATE says
+// otherwise.
+constexpr double DEFAULT_STEP_RATE = 60.0;
+
+// Most simulation steps run in a single frame while catching up after a
+// slow one.
+constexpr unsigned int MAX_CATCH_UP_STEPS = 5;
+
+// Animated nodes of the demo scene and how they're updated.
+struct DemoScene {
+    Node *root;
+    PerspectiveCamera *camera;
+    Node *parentThing;
+    Node *childThing;
+
+    // Extra cubes laid out in a grid, see createScene.
+    std::vector<Node *> grid;
+
+    // Pool spreading world transform updates over threads, if any.
+    ThreadPool *updatePool = nullptr;
+    std::size_t updateGrainSize = TransformStore::DEFAULT_GRAIN_SIZE;
+
+    // Number of steps simulated so far.
+    std::uint64_t steps = 0;
+};
+
+// Returns the number of simulation steps per second.
+double stepRate() {
+    auto stepRateStr = std::getenv("SCENEGRAPHDEMO_STEP_RATE");
+    if (stepRateStr != nullptr && std::strtod(stepRateStr, nullptr) > 0.0) {
+        return std::strtod(stepRateStr, nullptr);
+    }
+    return DEFAULT_STEP_RATE;
+}
+
+// Creates a scenegraph with some cubes and a camera in a pool, which owns the
+// nodes and tears them down along with itself. The update pool is created
+// when the environment asks for one.
+DemoScene createScene(NodePool &nodes, std::unique_ptr<ThreadPool> &updatePool) {
+    const float aspect = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
+    const float fov = glm::radians(45.0f);
+
+    DemoScene scene;
+    scene.root = nodes.create<Node>("root");
+    scene.camera = nodes.create<PerspectiveCamera>("camera",
+        glm::vec3(0, 0, -5), glm::vec3(0, glm::radians(180.0f), 0), VEC3_ONE,
+        fov, aspect, 0.1f, 100.0f);
+    scene.parentThing = nodes.create<Node>("parentThing", glm::vec3(-2, 0, 0), VEC3_ZERO);
+    scene.childThing = nodes.create<Node>("childThing", glm::vec3(2, 0, 0), VEC3_ZERO);
+    scene.root->add(scene.camera);
+    scene.root->add(scene.parentThing);
+    scene.parentThing->add(scene.childThing);
+    scene.parentThing->setLocalBounds(Aabb(glm::vec3(-0.5f), glm::vec3(0.5f)));
+    scene.childThing->setLocalBounds(Aabb(glm::vec3(-0.5f), glm::vec3(0.5f)));
+
+    // Draw submission and culling can be stress tested by asking for a grid
+    // of extra cubes in front of the camera. Each row of the grid hangs off
+    // a node of its own, so rows out of view are culled with one test.
+    auto cubesStr = std::getenv("SCENEGRAPHDEMO_CUBES");
+    const std::size_t cubes = cubesStr != nullptr ? std::strtoul(cubesStr, nullptr, 10) : 0;
+    const std::size_t side = (std::size_t)std::ceil(std::cbrt((double)cubes));
+    Node *row = nullptr;
+    for (std::size_t i = 0; i < cubes; i++) {
+        if (i % side == 0) {
+            row = nodes.create<Node>("gridRow", VEC3_ZERO, VEC3_ZERO);
+            scene.root->add(row);
+        }
+        const glm::vec3 cell((float)(i % side), (float)(i / side % side), (float)(i / (side * side)));
+        const glm::vec3 position = (cell - glm::vec3(side * 0.5f, side * 0.5f, 0.0f)) * 1.5f + glm::vec3(0, 0, 2);
+        auto node = nodes.create<Node>("gridCube", position, VEC3_ZERO);
+        node->setLocalBounds(Aabb(glm::vec3(-0.5f), glm::vec3(0.5f)));
+        row->add(node);
+        scene.grid.push_back(node);
+    }
+    scene.root->updateWorldTransform();
+    TransformStore::getDefault()->savePreviousWorldTransforms();
+
+    // World transforms are updated on the simulating thread unless a thread
+    // count is given, in which case large subtrees are spread over a thread
+    // pool.
+    auto updateThreadsStr = std::getenv("SCENEGRAPHDEMO_UPDATE_THREADS");
+    if (updateThreadsStr != nullptr) {
+        updatePool.reset(new ThreadPool(std::strtoul(updateThreadsStr, nullptr, 10)));
+        scene.updatePool = updatePool.get();
+        scenegraphdemo::info("Updating transforms on ", updatePool->size(), " threads");
+    }
+    auto updateGrainSizeStr = std::getenv("SCENEGRAPHDEMO_UPDATE_GRAIN_SIZE");
+    if (updateGrainSizeStr != nullptr) {
+        scene.updateGrainSize = std::strtoul(updateGrainSizeStr, nullptr, 10);
+    }
+    return scene;
+}
+
+// Advances the scene by one step of the given length in seconds. Animation
+// only depends on the number of steps taken, so the same steps always end in
+// the same state.
+void stepScene(DemoScene &scene, double step) {
+    TransformStore::getDefault()->savePreviousWorldTransforms();
+    scene.steps++;
+
+    // Update node transforms to demo scenegraph updates.
+    const float rotation = (float)(glm::radians(180.0) * step * scene.steps); // 180 degrees a second.
+    scene.parentThing->setRot(glm::vec3(0, rotation, 0));
+    scene.childThing->setRot(glm::vec3(0, 0, rotation));
+    scene.camera->setRot(glm::vec3(0, glm::radians(180.0f), rotation * 0.1));
+
+    // Update the world transforms of nodes and their children if their
+    // positions / rotations have been mutated.
+    if (scene.updatePool != nullptr) {
+        scene.root->updateWorldTransform(*scene.updatePool, scene.updateGrainSize);
+    } else {
+        scene.root->updateWorldTransform();
+    }
+}
+
+// Tests every node below node against a frustum on its own, ignoring the
+// bounds of the subtrees around it, and appends the visible ones. The
+// hierarchical cull must find exactly the same nodes.
+void cullBruteForce(Node *node, const Frustum &frustum, std::vector<Node *> &visible) {
+    std::uint8_t mask = Frustum::ALL_PLANES;
+    if (frustum.test(node->getWorldBounds(), mask) != Containment::OUTSIDE) {
+        visible.push_back(node);
+    }
+    for (auto child : node->children) {
+        cullBruteForce(child, frustum, visible);
+    }
+}
+
+// Points every node of the scene that's drawn at a renderable, for runs
+// without OpenGL where only the pointer matters.
+void setRenderables(DemoScene &scene, const Renderable *renderable) {
+    scene.parentThing->renderable = renderable;
+    scene.childThing->renderable = renderable;
+    for (auto node : scene.grid) {
+        node->renderable = renderable;
+    }
+}
+
+// Runs a number of frames through a serial frame pipeline and then through a
+// threaded one without a window or OpenGL, and logs the throughput and
+// latency of both. Every frame simulates a single step. Drawing is stood in
+// for by computing the model view projection matrix of every item, as the
+// render queue does before uploading them.
+void benchmarkPipeline(std::uint64_t frames) {
+    NodePool nodes;
+    std::unique_ptr<ThreadPool> updatePool;
+    DemoScene scene = createScene(nodes, updatePool);
+    Renderable cube;
+    setRenderables(scene, &cube);
+
+    const double step = 1.0 / stepRate();
+    std::vector<glm::mat4> transforms;
+    for (bool threaded : {false, true}) {
+        FramePipeline pipeline([&](FrameSnapshot &snapshot) {
+            stepScene(scene, step);
+            snapshot.capture(scene.root, *scene.camera);
+        }, threaded);
+        for (std::uint64_t i = 0; i < frames; i++) {
+            const FrameSnapshot &snapshot = pipeline.acquire();
+            transforms.resize(snapshot.items.size());
+            for (std::size_t j = 0; j < snapshot.items.size(); j++) {
+                multiplyTransform(snapshot.viewProjectionMatrix, snapshot.items[j].worldTransform, transforms[j]);
+            }
+            pipeline.present();
+        }
+
+        const PipelineStats stats = pipeline.getStats();
+        scenegraphdemo::info(threaded ? "Pipelined: " : "Serial: ", stats.frames, " frames at ",
+            stats.framesPerSecond, " fps, ", stats.averageLatency, " ms average latency, ",
+            stats.maximumLatency, " ms max, ", stats.averageSimulation, " ms simulating and ",
+            stats.averageWait, " ms waiting per frame");
+    }
+}
+
+// Simulates and culls a number of steps as fast as possible without a window
+// or OpenGL, then logs how long that took along with a checksum of the final
+// frame. The checksum only changes when the simulation's results do. The
+// final frame's cull is checked against a brute-force one.
+//
+// When SCENEGRAPHDEMO_BENCHMARK names a benchmark, that runs instead with the
+// steps as its iteration count.
+void runHeadless(std::uint64_t steps) {
+    auto benchmarkStr = std::getenv("SCENEGRAPHDEMO_BENCHMARK");
+    if (benchmarkStr != nullptr && std::string(benchmarkStr) == "pipeline") {
+        benchmarkPipeline(steps);
+        return;
+    }
+    if (benchmarkStr != nullptr) {
+        BenchmarkOptions options;
+        options.iterations = steps;
+        auto benchmarkSizeStr = std::getenv("SCENEGRAPHDEMO_BENCHMARK_SIZE");
+        if (benchmarkSizeStr != nullptr) {
+            options.size = std::strtoull(benchmarkSizeStr, nullptr, 10);
+        }
+        auto benchmarkFileStr = std::getenv("SCENEGRAPHDEMO_BENCHMARK_FILE");
+        if (benchmarkFileStr != nullptr) {
+            options.file = benchmarkFileStr;
+        }
+        auto resourceDirStr = std::getenv("SCENEGRAPHDEMO_RESOURCE_DIR");
+        if (resourceDirStr != nullptr) {
+            options.directory = resourceDirStr;
+        }
+        std::unique_ptr<ThreadPool> pool;
+        auto updateThreadsStr = std::getenv("SCENEGRAPHDEMO_UPDATE_THREADS");
+        if (updateThreadsStr != nullptr) {
+            pool.reset(new ThreadPool(std::strtoul(updateThreadsStr, nullptr, 10)));
+            options.pool = pool.get();
+        }
+        auto updateGrainSizeStr = std::getenv("SCENEGRAPHDEMO_UPDATE_GRAIN_SIZE");
+        if (updateGrainSizeStr != nullptr) {
+            options.grainSize = std::strtoul(updateGrainSizeStr, nullptr, 10);
+        }
+        if (!runBenchmark(benchmarkStr, options)) {
+            scenegraphdemo::error("Unknown benchmark \"", benchmarkStr, "\"");
+        }
+        return;
+    }
+
+    NodePool nodes;
+    std::unique_ptr<ThreadPool> updatePool;
+    DemoScene scene = createScene(nodes, updatePool);
+    Renderable cube;
+    setRenderables(scene, &cube);
+
+    const double step = 1.0 / stepRate();
+    FrameSnapshot snapshot;
+    const auto begin = std::chrono::steady_clock::now();
+    for (std::uint64_t i = 0; i < steps; i++) {
+        stepScene(scene, step);
+        snapshot.capture(scene.root, *scene.camera);
+    }
+    const double elapsed = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - begin).count();
+
+    std::vector<glm::mat4> transforms(1, snapshot.viewProjectionMatrix);
+    for (const auto &item : snapshot.items) {
+        transforms.push_back(item.worldTransform);
+    }
+    std::ostringstream checksum;
+    checksum << std::hex << hashBytes(reinterpret_cast<const char *>(transforms.data()),
+        transforms.size() * sizeof(glm::mat4));
+    scenegraphdemo::info("Simulated ", steps, " steps in ", elapsed, " ms (",
+        steps > 0 ? elapsed * 1000.0 / steps : 0.0, " us per step), checksum ", checksum.str());
+
+    const CullStats &cullStats = snapshot.cullStats;
+    scenegraphdemo::info("Last cull visited ", cullStats.visited, " of ", nodes.size(), " nodes, rejecting ",
+        cullStats.culled, " subtrees and finding ", cullStats.visible, " visible");
+
+    const Frustum frustum(scene.camera->viewProjectionMatrix);
+    FrustumCuller culler;
+    std::vector<Node *> visible;
+    std::vector<Node *> expected;
+    culler.cull(scene.root, frustum, visible);
+    cullBruteForce(scene.root, frustum, expected);
+    std::sort(visible.begin(), visible.end());
+    std::sort(expected.begin(), expected.end());
+    if (visible != expected) {
+        scenegraphdemo::error("Hierarchical cull found ", visible.size(), " visible nodes, brute force found ",
+            expected.size());
+    } else {
+        scenegraphdemo::info("Hierarchical cull matches brute force");
+    }
+}
+
+// Logs how a resource cache has been used.
+void logCacheStats(const char *name, const ResourceCacheStats &stats) {
+    scenegraphdemo::info(name, " cache had ", stats.hits, " hits, ", stats.misses, " misses and ",
+        stats.evictions, " evictions, holding ", stats.entries, " entries of ", stats.bytes, " bytes");
+}
+
 // The main game loop on the OpenGL thread. Draw calls are done here and at the
 // moment input is processed here as well.
 void run(SDL_Window *window) {
@@ -80,107 +374,181 @@ void run(SDL_Window *window) {
     }
     boost::filesystem::path resourceDir = resourceDirStr;
 
-    // Tightly-packed buffer containing vertex positions and texture coordinates
-    // associated with them. These are used to draw a textured rectangle.
-    const float vertices[] = {
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-         0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-
-        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-         0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
-         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
-    };
-
-    unsigned int vao;
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-
-    unsigned int vbo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    glBindVertexArray(0);
-
-    // Load a texture to use for all the cubes.
-    boost::filesystem::path textureTestPath = resourceDir / "textures/ground_03.jpg";
-    ImageResource textureTest(textureTestPath.string());
+    // Assets packed into an archive are read from it as if it was extracted
+    // into the resource directory.
+    auto assetArchiveStr = std::getenv("SCENEGRAPHDEMO_ASSET_ARCHIVE");
+    if (assetArchiveStr != nullptr) {
+        mountArchive(std::make_shared<AssetArchive>(assetArchiveStr), resourceDir.string());
+        scenegraphdemo::info("Mounted asset archive ", assetArchiveStr);
+    }
 
-    const float aspect = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
-    const float fov = glm::radians(45.0f);
+    // Images are converted into containers holding their mip chains on first
+    // use, so later runs map them instead of decoding.
+    auto textureCacheDirStr = std::getenv("SCENEGRAPHDEMO_TEXTURE_CACHE_DIR");
+    if (textureCacheDirStr != nullptr) {
+        TextureCache::setDefault(std::make_shared<TextureCache>(textureCacheDirStr));
+    }
 
-    // Create a scenegraph with some cubes and a camera.
-    auto scenegraph = std::make_shared<Node>("root");
-    auto camera = std::make_shared<PerspectiveCamera>("camera",
-        glm::vec3(0, 0, -5), glm::vec3(0, glm::radians(180.0f), 0), VEC3_ONE,
-        fov, aspect, 0.1f, 100.0f);
-    auto parentThing = std::make_shared<Node>("parentThing", glm::vec3(-2, 0, 0), VEC3_ZERO);
-    auto childThing = std::make_shared<Node>("childThing", glm::vec3(2, 0, 0), VEC3_ZERO);
-    scenegraph.get()->add(camera);
-    scenegraph.get()->add(parentThing);
-    parentThing.get()->add(childThing);
-    scenegraph.get()->updateWorldTransform();
-
-    // Compile a basic shader for use with the cube.
-    boost::filesystem::path vertexShaderPath = resourceDir / "shaders/basic_vertex.glsl";
-    RawResource vertexShader(vertexShaderPath.string());
+    // Linked shader programs are kept in the same way, so shaders are only
+    // compiled when their sources or the driver change.
+    auto shaderCacheDirStr = std::getenv("SCENEGRAPHDEMO_SHADER_CACHE_DIR");
+    if (shaderCacheDirStr != nullptr) {
+        ProgramBinaryCache::setDefault(std::make_shared<ProgramBinaryCache>(shaderCacheDirStr));
+    }
+
+    // Resources are requested through caches so a file is only ever loaded
+    // once, no matter how many things use it. Nothing reads texture pixels on
+    // the CPU, so they're only kept in video memory.
+    ThreadPool loaderPool(2);
+    TextureLoader textureLoader(loaderPool);
+    ResourceCache<ImageResource> textures(
+        [&textureLoader](const std::string &path) { return textureLoader.load(path, ImageResidency::RELEASE); },
+        [](const ImageResource &image) { return image.getByteSize(); });
+    ResourceCache<RawResource> files(
+        [](const std::string &path) { return std::make_shared<RawResource>(path, RawResourceMode::MAP); },
+        [](const RawResource &file) { return file.size(); });
+    ResourceCache<Mesh> meshes(
+        [](const std::string &path) { return std::make_shared<Mesh>(path); },
+        [](const Mesh &mesh) { return mesh.getByteSize(); });
+
+    // Load the mesh every cube is drawn with. Its vertices are merged and its
+    // triangles reordered for the vertex cache as it's imported.
+    boost::filesystem::path cubeMeshPath = resourceDir / "models/cube.obj";
+    auto cubeMesh = meshes.get(cubeMeshPath.string());
+
+    // Grid cubes are drawn as several small shapes packed into one vertex
+    // array, each with its own range of the index buffer, so the grid has as
+    // many distinct runs of geometry to submit as there are shapes.
+    std::vector<std::string> shapePaths;
+    for (auto shape : {"cube", "tetrahedron", "octahedron", "pyramid", "prism"}) {
+        shapePaths.push_back((resourceDir / "models" / (std::string(shape) + ".obj")).string());
+    }
+    auto shapeMesh = std::make_shared<Mesh>("shapes", shapePaths);
+
+    // Load a texture to use for all the cubes. It's decoded in the background
+    // and the cubes are drawn with a placeholder until it's uploaded.
+    boost::filesystem::path textureTestPath = resourceDir / "textures/ground_03.jpg";
+    auto textureTest = textures.get(textureTestPath.string());
+
+    // Create a scenegraph with some cubes and a camera. Every node is owned by
+    // the pool and torn down with it when the loop exits.
+    NodePool nodes;
+    std::unique_ptr<ThreadPool> updatePool;
+    DemoScene scene = createScene(nodes, updatePool);
+
+    // Compile a shader that reads each cube's transform from per-instance
+    // vertex attributes.
+    boost::filesystem::path vertexShaderPath = resourceDir / "shaders/instanced_vertex.glsl";
+    auto vertexShader = files.get(vertexShaderPath.string());
     boost::filesystem::path fragmentShaderPath = resourceDir / "shaders/basic_fragment.glsl";
-    RawResource fragmentShader(fragmentShaderPath.string());
-    auto basicShader = Shader(vertexShader.data(), fragmentShader.data());
+    auto fragmentShader = files.get(fragmentShaderPath.string());
+    auto shaderBegin = std::chrono::steady_clock::now();
+    auto basicShader = Shader(vertexShader->c_str(), fragmentShader->c_str());
+    double shaderBuildTime = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - shaderBegin).count();
+    basicShader.use();
     basicShader.setUniformInt("texture0", 0);
 
-    Uint64 now = SDL_GetPerformanceCounter();
-    Uint64 last = 0;
-    float delta = 1.0f;
-    float rotation = 0.0;
+    // Once textures are loaded they're packed into texture arrays and drawn
+    // with a shader that picks each instance's layer, so renderables with
+    // different textures can share draw calls.
+    boost::filesystem::path arrayVertexShaderPath = resourceDir / "shaders/instanced_array_vertex.glsl";
+    auto arrayVertexShader = files.get(arrayVertexShaderPath.string());
+    boost::filesystem::path arrayFragmentShaderPath = resourceDir / "shaders/array_fragment.glsl";
+    auto arrayFragmentShader = files.get(arrayFragmentShaderPath.string());
+    shaderBegin = std::chrono::steady_clock::now();
+    auto arrayShader = Shader(arrayVertexShader->c_str(), arrayFragmentShader->c_str());
+    shaderBuildTime += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - shaderBegin).count();
+    arrayShader.use();
+    arrayShader.setUniformInt("texture0", 0);
+    TextureArrayBuilder textureArrays;
+    bool texturesPacked = false;
+
+    // Both cubes share the same mesh, shader and texture so the render queue
+    // sorts them next to each other and draws them with one instanced call.
+    Renderable cube;
+    cubeMesh->assign(cube);
+    cube.shader = &basicShader;
+    cube.texture = textureTest.get();
+    scene.parentThing->renderable = &cube;
+    scene.childThing->renderable = &cube;
+
+    // Grid cubes take turns drawing each of the shapes, which share the
+    // cubes' shader and texture but draw different parts of their mesh.
+    std::vector<Renderable> shapes(shapeMesh->getParts().size());
+    for (std::size_t i = 0; i < shapes.size(); i++) {
+        shapeMesh->assign(shapes[i], i);
+        shapes[i].shader = &basicShader;
+        shapes[i].texture = textureTest.get();
+    }
+    for (std::size_t i = 0; i < scene.grid.size(); i++) {
+        scene.grid[i]->renderable = &shapes[i % shapes.size()];
+    }
 
+    RenderQueue renderQueue;
+    auto indirectStr = std::getenv("SCENEGRAPHDEMO_INDIRECT");
+    if (indirectStr != nullptr && std::string(indirectStr) == "0") {
+        renderQueue.setIndirect(false);
+    }
+    scenegraphdemo::info("Drawing with ", renderQueue.isIndirect() ? "indirect" : "direct", " draw calls");
+
+    // Frames are profiled into a Chrome trace when a file to write it to is
+    // given.
+    auto profilePathStr = std::getenv("SCENEGRAPHDEMO_PROFILE");
+    Profiler &profiler = Profiler::get();
+    if (profilePathStr != nullptr) {
+        Profiler::setEnabled(true);
+        profiler.startCapture();
+    }
+
+    // The scene advances in fixed steps, and frames are drawn from a blend
+    // of the last two steps.
+    FixedTimestep timestep(1.0 / stepRate(), MAX_CATCH_UP_STEPS);
+    Uint64 last = SDL_GetPerformanceCounter();
+
+    // Everything that touches the scenegraph happens here. When pipelining
+    // is turned on it runs on a thread of its own, simulating the next frame
+    // while the current one is drawn from its snapshot. Otherwise each frame
+    // is simulated on the OpenGL thread right before it's drawn.
+    const bool pipelined = std::getenv("SCENEGRAPHDEMO_PIPELINE") != nullptr;
+    std::unique_ptr<FramePipeline> pipeline(new FramePipeline([&](FrameSnapshot &snapshot) {
+        // Real time decides how many steps are due, so animation speed
+        // doesn't depend on the frame rate and simulation cost doesn't grow
+        // with it.
+        const Uint64 now = SDL_GetPerformanceCounter();
+        const unsigned int steps = timestep.advance(
+            (double)(now - last) / (double)SDL_GetPerformanceFrequency());
+        last = now;
+        {
+            ProfileScope scope("update");
+            for (unsigned int i = 0; i < steps; i++) {
+                stepScene(scene, timestep.getStep());
+            }
+        }
+
+        ProfileScope scope("cull");
+        snapshot.capture(scene.root, *scene.camera, timestep.getAlpha());
+    }, pipelined));
+    if (pipelined) {
+        scenegraphdemo::info("Simulating the scenegraph on its own thread");
+    }
+
+    // Benchmarks of drawing can stop after a number of frames instead of
+    // waiting for the window to be closed.
+    std::uint64_t frameLimit = 0;
+    auto framesStr = std::getenv("SCENEGRAPHDEMO_FRAMES");
+    if (framesStr != nullptr) {
+        frameLimit = std::strtoull(framesStr, nullptr, 10);
+    }
+
+    std::uint64_t frames = 0;
     bool running = true;
     while (running) {
-        // Delta time is calculated then incorporated with time-related
-        // functionality such as the rotation of the cubes. Delta time is used
-        // so frame drops do not affect animation speeds.
-        last = now;
-        now = SDL_GetPerformanceCounter();
-        delta = (double)((now - last) * 1000 / (double)SDL_GetPerformanceFrequency()) / 16 / 60;
+        // Collect the previous frame's timings before this frame's scope
+        // starts.
+        profiler.endFrame();
+        ProfileScope frameScope("frame");
 
         // Check for key / window system events (only used to check for close
         // request for this example).
@@ -189,41 +557,111 @@ void run(SDL_Window *window) {
             running = handleEvents(&event);
         }
 
-        // Update node transforms to demo scenegraph updates.
-        rotation += glm::radians(180.0f) * delta; // 180 degrees a second.
-        parentThing.get()->setRot(glm::vec3(0, rotation, 0));
-        childThing.get()->setRot(glm::vec3(0, 0, rotation));
-        camera.get()->setRot(glm::vec3(0, glm::radians(180.0f), rotation * 0.1));
-
-        // Update the world transforms of nodes and their children if their
-        // positions / rotations have been mutated.
-        scenegraph.get()->updateWorldTransform();
-
-        glEnable(GL_DEPTH_TEST);
-        glClearColor(0.3, 0.6, 0.8, 1.0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Draw the parent cube.
-        auto modelViewProjectionMatrix = camera.get()->viewProjectionMatrix * parentThing.get()->worldTransform;
-        basicShader.setUniformMat4("transform", glm::value_ptr(modelViewProjectionMatrix));
-        basicShader.use();
-        textureTest.bind();
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        // Draw the child cube.
-        modelViewProjectionMatrix = camera.get()->viewProjectionMatrix * childThing.get()->worldTransform;
-        basicShader.setUniformMat4("transform", glm::value_ptr(modelViewProjectionMatrix));
-        basicShader.use();
-        textureTest.bind();
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        glBindVertexArray(0);
-        SDL_GL_SwapWindow(window);
+        // Stream in textures that finished decoding.
+        {
+            ProfileScope scope("textures");
+            textureLoader.update();
+            if (!texturesPacked && textureTest->isLoaded()) {
+                textureArrays.add(textureTest);
+                textureArrays.build();
+                if (textureArrays.assign(cube)) {
+                    cube.shader = &arrayShader;
+                }
+                for (auto &shape : shapes) {
+                    if (textureArrays.assign(shape)) {
+                        shape.shader = &arrayShader;
+                    }
+                }
+                texturesPacked = true;
+
+                // Nothing draws from the image's own texture anymore, so
+                // it's dropped instead of being kept in video memory twice.
+                if (cube.textureArray != nullptr) {
+                    textureTest.reset();
+                    textures.evictUnused();
+                }
+            }
+        }
+
+        const FrameSnapshot &snapshot = pipeline->acquire();
+        {
+            GpuProfileScope gpuScope("draw");
+            glEnable(GL_DEPTH_TEST);
+            glClearColor(0.3, 0.6, 0.8, 1.0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            ProfileScope scope("draw");
+            renderQueue.submit(snapshot);
+            renderQueue.flush(snapshot.viewProjectionMatrix);
+        }
+
+        {
+            ProfileScope scope("swap");
+            SDL_GL_SwapWindow(window);
+        }
+        pipeline->present();
+
+        frames++;
+        if (frameLimit > 0 && frames >= frameLimit) {
+            running = false;
+        }
+    }
+
+    // Stopping the pipeline hands the scenegraph back to this thread.
+    const PipelineStats pipelineStats = pipeline->getStats();
+    pipeline.reset();
+    scenegraphdemo::info(pipelined ? "Pipelined: " : "Serial: ", pipelineStats.frames, " frames at ",
+        pipelineStats.framesPerSecond, " fps, ", pipelineStats.averageLatency, " ms average latency, ",
+        pipelineStats.maximumLatency, " ms max, ", pipelineStats.averageSimulation, " ms simulating and ",
+        pipelineStats.averageWait, " ms waiting per frame");
+    const RenderStats &renderStats = renderQueue.getStats();
+    scenegraphdemo::info("Last frame drew ", renderStats.items, " items in ", renderStats.runs, " runs with ",
+        renderStats.drawCalls, " draw calls");
+    scenegraphdemo::info("Uploaded ", basicShader.getUniformUploads() + arrayShader.getUniformUploads(),
+        " uniforms, skipping ", basicShader.getSkippedUniformUploads() + arrayShader.getSkippedUniformUploads(),
+        " that were already set");
+    scenegraphdemo::info("Built shaders in ", shaderBuildTime, " ms");
+    if (auto shaderCache = ProgramBinaryCache::getDefault()) {
+        const ProgramBinaryCacheStats shaderCacheStats = shaderCache->getStats();
+        scenegraphdemo::info("Shader cache had ", shaderCacheStats.hits, " hits and ", shaderCacheStats.misses,
+            " misses, with ", shaderCacheStats.rejected, " binaries rejected by the driver and ",
+            shaderCacheStats.stored, " stored");
+    }
+    const TextureLoaderStats loaderStats = textureLoader.getStats();
+    scenegraphdemo::info("Loaded ", loaderStats.uploaded, " of ", loaderStats.requested, " textures with ",
+        loaderStats.failed, " failures, reading them for ", loaderStats.loadTime, " ms (", loaderStats.cached,
+        " through the texture cache) and uploading for ", loaderStats.uploadTime, " ms in total and at most ",
+        loaderStats.maximumUpdateTime, " ms in one frame");
+    logCacheStats("Texture", textures.getStats());
+    logCacheStats("File", files.getStats());
+    logCacheStats("Mesh", meshes.getStats());
+    const StreamBufferStats &streamStats = renderQueue.getStreamStats();
+    scenegraphdemo::info("Streamed instance data for ", streamStats.frames, " frames with ",
+        streamStats.fenceStalls, " fence stalls taking ", streamStats.fenceStallTime, " ms, ",
+        streamStats.reallocations, " reallocations and ", streamStats.orphans, " orphans");
+    scenegraphdemo::info("Simulated ", timestep.getSteps(), " steps of ", timestep.getStep() * 1000.0,
+        " ms, dropping ", timestep.getDroppedTime() * 1000.0, " ms to the catch-up limit");
+
+    if (profilePathStr != nullptr) {
+        profiler.endFrame();
+        for (const auto &stats : profiler.getStats()) {
+            scenegraphdemo::info(stats.name, ": ", stats.average, " ms average, ",
+                stats.minimum, " ms min, ", stats.maximum, " ms max over ", stats.frames, " frames");
+        }
+        profiler.writeCapture(profilePathStr);
+        scenegraphdemo::info("Wrote profile to ", profilePathStr);
     }
+    profiler.releaseGpu();
 }
 
 int main(int argc, char **argv) {
+    // Benchmarks of the simulation alone don't need a display.
+    auto headlessStepsStr = std::getenv("SCENEGRAPHDEMO_HEADLESS_STEPS");
+    if (headlessStepsStr != nullptr) {
+        runHeadless(std::strtoull(headlessStepsStr, nullptr, 10));
+        return 0;
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
         std::cerr << "Failed to initialize SDL video subsystem (no display?)" << std::endl;
         checkSDLError(__LINE__);
@@ -0,0 +1,103 @@
+#include "math/bounds.hpp"
+#include <cmath>
+#include <glm/glm.hpp>
+
+namespace scenegraphdemo {
+    constexpr unsigned int Frustum::PLANE_COUNT;
+    constexpr std::uint8_t Frustum::ALL_PLANES;
+
+    Aabb mergeBounds(const Aabb &a, const Aabb &b) {
+        return Aabb(glm::min(a.min, b.min), glm::max(a.max, b.max));
+    }
+
+    Aabb transformBounds(const glm::mat4 &transform, const Aabb &bounds) {
+        if (bounds.empty()) {
+            return Aabb();
+        }
+
+        // Transform the center, then project the extents onto each world
+        // axis through the absolute values of the rotation and scale.
+        const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+        const glm::vec3 extents = (bounds.max - bounds.min) * 0.5f;
+        const glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+        glm::vec3 worldExtents(0.0f);
+        for (int column = 0; column < 3; column++) {
+            worldExtents += glm::abs(glm::vec3(transform[column])) * extents[column];
+        }
+        return Aabb(worldCenter - worldExtents, worldCenter + worldExtents);
+    }
+
+    BoundingSphere sphereFromBounds(const Aabb &bounds) {
+        BoundingSphere sphere;
+        if (!bounds.empty()) {
+            sphere.center = (bounds.min + bounds.max) * 0.5f;
+            sphere.radius = glm::length(bounds.max - bounds.min) * 0.5f;
+        }
+        return sphere;
+    }
+
+    Frustum::Frustum(const glm::mat4 &viewProjectionMatrix) {
+        // Each plane is the sum or difference of the fourth row of the matrix
+        // and one of the others (Gribb and Hartmann). glm is column-major, so
+        // rows are gathered across columns.
+        glm::vec4 rows[4];
+        for (int row = 0; row < 4; row++) {
+            rows[row] = glm::vec4(
+                viewProjectionMatrix[0][row],
+                viewProjectionMatrix[1][row],
+                viewProjectionMatrix[2][row],
+                viewProjectionMatrix[3][row]);
+        }
+        for (unsigned int i = 0; i < PLANE_COUNT; i++) {
+            const glm::vec4 &row = rows[i / 2];
+            glm::vec4 plane = i % 2 == 0 ? rows[3] + row : rows[3] - row;
+            planes[i] = plane / glm::length(glm::vec3(plane));
+        }
+    }
+
+    Containment Frustum::test(const Aabb &bounds, std::uint8_t &mask) const {
+        if (bounds.empty()) {
+            return Containment::OUTSIDE;
+        }
+
+        const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+        const glm::vec3 extents = (bounds.max - bounds.min) * 0.5f;
+        for (unsigned int i = 0; i < PLANE_COUNT; i++) {
+            const std::uint8_t bit = 1 << i;
+            if (!(mask & bit)) {
+                continue;
+            }
+            const glm::vec3 normal = glm::vec3(planes[i]);
+            const float distance = glm::dot(normal, center) + planes[i].w;
+            const float radius = glm::dot(extents, glm::abs(normal));
+            if (distance + radius < 0.0f) {
+                return Containment::OUTSIDE;
+            }
+            if (distance - radius >= 0.0f) {
+                mask &= ~bit;
+            }
+        }
+        return mask == 0 ? Containment::INSIDE : Containment::INTERSECTING;
+    }
+
+    Containment Frustum::test(const BoundingSphere &sphere, std::uint8_t &mask) const {
+        if (sphere.radius < 0.0f) {
+            return Containment::OUTSIDE;
+        }
+
+        for (unsigned int i = 0; i < PLANE_COUNT; i++) {
+            const std::uint8_t bit = 1 << i;
+            if (!(mask & bit)) {
+                continue;
+            }
+            const float distance = glm::dot(glm::vec3(planes[i]), sphere.center) + planes[i].w;
+            if (distance < -sphere.radius) {
+                return Containment::OUTSIDE;
+            }
+            if (distance >= sphere.radius) {
+                mask &= ~bit;
+            }
+        }
+        return mask == 0 ? Containment::INSIDE : Containment::INTERSECTING;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <cmath>
+#include <cstdint>
+
+namespace scenegraphdemo {
+    // Axis-aligned bounding box. A box whose minimum exceeds its maximum is
+    // empty, which is the default, and contains nothing.
+    struct Aabb {
+        glm::vec3 min = glm::vec3(INFINITY);
+        glm::vec3 max = glm::vec3(-INFINITY);
+
+        Aabb() {}
+        Aabb(glm::vec3 min, glm::vec3 max) : min(min), max(max) {}
+
+        // Returns whether the box contains nothing.
+        bool empty() const {
+            return min.x > max.x || min.y > max.y || min.z > max.z;
+        }
+    };
+
+    // Bounding sphere. A negative radius marks an empty sphere.
+    struct BoundingSphere {
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = -1.0f;
+    };
+
+    // Returns the smallest box enclosing both boxes.
+    Aabb mergeBounds(const Aabb &a, const Aabb &b);
+
+    // Returns the box enclosing a box after it's transformed by a matrix.
+    Aabb transformBounds(const glm::mat4 &transform, const Aabb &bounds);
+
+    // Returns the sphere enclosing a box.
+    BoundingSphere sphereFromBounds(const Aabb &bounds);
+
+    // Result of testing a volume against a frustum.
+    enum class Containment : std::uint8_t {
+        OUTSIDE,
+        INTERSECTING,
+        INSIDE,
+    };
+
+    // View frustum described by six inward-facing planes, stored as normal
+    // and distance with normalized normals.
+    class Frustum {
+    public:
+        // Number of planes bounding a frustum.
+        static constexpr unsigned int PLANE_COUNT = 6;
+
+        // Plane mask with every plane set.
+        static constexpr std::uint8_t ALL_PLANES = (1 << PLANE_COUNT) - 1;
+
+        // Left, right, bottom, top, near and far planes.
+        glm::vec4 planes[PLANE_COUNT];
+
+        // Extracts the planes of the volume a view projection matrix maps to
+        // clip space.
+        explicit Frustum(const glm::mat4 &viewProjectionMatrix);
+
+        // Tests a box against the planes set in mask. Planes the box is fully
+        // inside of are cleared from mask, so children of a box can skip
+        // them.
+        Containment test(const Aabb &bounds, std::uint8_t &mask) const;
+
+        // Same as above, but for a sphere.
+        Containment test(const BoundingSphere &sphere, std::uint8_t &mask) const;
+    };
+}
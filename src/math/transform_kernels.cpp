@@ -0,0 +1,197 @@
+#include "math/transform_kernels.hpp"
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#if defined(__AVX__)
+#define SCENEGRAPHDEMO_KERNELS_AVX
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SCENEGRAPHDEMO_KERNELS_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace scenegraphdemo {
+#if defined(SCENEGRAPHDEMO_KERNELS_AVX)
+    // Multiplies two column-major matrices two result columns at a time. Each
+    // 256-bit register holds a pair of columns, and the columns of the left
+    // matrix are broadcast into both halves.
+    static inline void multiplyColumns(const float *lhs, const float *rhs, float *out) {
+        const __m256 l0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(lhs + 0));
+        const __m256 l1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(lhs + 4));
+        const __m256 l2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(lhs + 8));
+        const __m256 l3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(lhs + 12));
+        // Both halves of the right matrix are loaded before storing so the
+        // output may alias either input.
+        const __m256 r01 = _mm256_loadu_ps(rhs + 0);
+        const __m256 r23 = _mm256_loadu_ps(rhs + 8);
+
+        __m256 result[2];
+        const __m256 columns[2] = {r01, r23};
+        for (int i = 0; i < 2; i++) {
+            const __m256 r = columns[i];
+            __m256 sum = _mm256_mul_ps(l0, _mm256_shuffle_ps(r, r, 0x00));
+#if defined(__FMA__)
+            sum = _mm256_fmadd_ps(l1, _mm256_shuffle_ps(r, r, 0x55), sum);
+            sum = _mm256_fmadd_ps(l2, _mm256_shuffle_ps(r, r, 0xAA), sum);
+            sum = _mm256_fmadd_ps(l3, _mm256_shuffle_ps(r, r, 0xFF), sum);
+#else
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(l1, _mm256_shuffle_ps(r, r, 0x55)));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(l2, _mm256_shuffle_ps(r, r, 0xAA)));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(l3, _mm256_shuffle_ps(r, r, 0xFF)));
+#endif
+            result[i] = sum;
+        }
+        _mm256_storeu_ps(out + 0, result[0]);
+        _mm256_storeu_ps(out + 8, result[1]);
+    }
+#elif defined(SCENEGRAPHDEMO_KERNELS_SSE)
+    // Multiplies two column-major matrices one result column at a time by
+    // broadcasting each component of the right column.
+    static inline void multiplyColumns(const float *lhs, const float *rhs, float *out) {
+        const __m128 l0 = _mm_loadu_ps(lhs + 0);
+        const __m128 l1 = _mm_loadu_ps(lhs + 4);
+        const __m128 l2 = _mm_loadu_ps(lhs + 8);
+        const __m128 l3 = _mm_loadu_ps(lhs + 12);
+
+        __m128 result[4];
+        for (int i = 0; i < 4; i++) {
+            const __m128 r = _mm_loadu_ps(rhs + i * 4);
+            __m128 sum = _mm_mul_ps(l0, _mm_shuffle_ps(r, r, 0x00));
+            sum = _mm_add_ps(sum, _mm_mul_ps(l1, _mm_shuffle_ps(r, r, 0x55)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(l2, _mm_shuffle_ps(r, r, 0xAA)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(l3, _mm_shuffle_ps(r, r, 0xFF)));
+            result[i] = sum;
+        }
+        for (int i = 0; i < 4; i++) {
+            _mm_storeu_ps(out + i * 4, result[i]);
+        }
+    }
+#else
+    // Portable fallback used when no vector instruction set is available.
+    static inline void multiplyColumns(const float *lhs, const float *rhs, float *out) {
+        float result[16];
+        for (int column = 0; column < 4; column++) {
+            for (int row = 0; row < 4; row++) {
+                result[column * 4 + row] =
+                    lhs[0 * 4 + row] * rhs[column * 4 + 0] +
+                    lhs[1 * 4 + row] * rhs[column * 4 + 1] +
+                    lhs[2 * 4 + row] * rhs[column * 4 + 2] +
+                    lhs[3 * 4 + row] * rhs[column * 4 + 3];
+            }
+        }
+        for (int i = 0; i < 16; i++) {
+            out[i] = result[i];
+        }
+    }
+#endif
+
+    const char *transformKernelIsa() {
+#if defined(SCENEGRAPHDEMO_KERNELS_AVX)
+        return "avx";
+#elif defined(SCENEGRAPHDEMO_KERNELS_SSE)
+        return "sse";
+#else
+        return "scalar";
+#endif
+    }
+
+    glm::quat orientationFromEuler(const glm::vec3 &rotation) {
+        const float sx = std::sin(rotation.x * 0.5f), cx = std::cos(rotation.x * 0.5f);
+        const float sy = std::sin(rotation.y * 0.5f), cy = std::cos(rotation.y * 0.5f);
+        const float sz = std::sin(rotation.z * 0.5f), cz = std::cos(rotation.z * 0.5f);
+
+        // Expanded product of the y, x and z axis rotations.
+        return glm::quat(
+            cy * cx * cz + sy * sx * sz,
+            cy * sx * cz + sy * cx * sz,
+            sy * cx * cz - cy * sx * sz,
+            cy * cx * sz - sy * sx * cz);
+    }
+
+    glm::vec3 eulerFromOrientation(const glm::quat &orientation) {
+        const glm::mat3 rotation = glm::mat3_cast(orientation);
+        // The third column of Ry * Rx * Rz is (sin y cos x, -sin x,
+        // cos y cos x) and the second row is (cos x sin z, cos x cos z).
+        return glm::vec3(
+            std::asin(glm::clamp(-rotation[2][1], -1.0f, 1.0f)),
+            std::atan2(rotation[2][0], rotation[2][2]),
+            std::atan2(rotation[0][1], rotation[1][1]));
+    }
+
+    glm::mat4 composeTransform(const glm::vec3 &position,
+            const glm::quat &orientation, const glm::vec3 &scale) {
+        const float xx = orientation.x * orientation.x;
+        const float yy = orientation.y * orientation.y;
+        const float zz = orientation.z * orientation.z;
+        const float xy = orientation.x * orientation.y;
+        const float xz = orientation.x * orientation.z;
+        const float yz = orientation.y * orientation.z;
+        const float wx = orientation.w * orientation.x;
+        const float wy = orientation.w * orientation.y;
+        const float wz = orientation.w * orientation.z;
+
+        // Columns of the rotation matrix, each scaled by the matching scale
+        // axis.
+        glm::mat4 transform;
+        transform[0] = glm::vec4(
+            (1.0f - 2.0f * (yy + zz)) * scale.x,
+            (2.0f * (xy + wz)) * scale.x,
+            (2.0f * (xz - wy)) * scale.x,
+            0.0f);
+        transform[1] = glm::vec4(
+            (2.0f * (xy - wz)) * scale.y,
+            (1.0f - 2.0f * (xx + zz)) * scale.y,
+            (2.0f * (yz + wx)) * scale.y,
+            0.0f);
+        transform[2] = glm::vec4(
+            (2.0f * (xz + wy)) * scale.z,
+            (2.0f * (yz - wx)) * scale.z,
+            (1.0f - 2.0f * (xx + yy)) * scale.z,
+            0.0f);
+        transform[3] = glm::vec4(position, 1.0f);
+        return transform;
+    }
+
+    glm::mat4 interpolateTransform(const glm::mat4 &from, const glm::mat4 &to, float alpha) {
+        if (alpha <= 0.0f) {
+            return from;
+        }
+        if (alpha >= 1.0f || from == to) {
+            return to;
+        }
+
+        // The lengths of the basis columns are the scale, and the normalized
+        // columns are the rotation.
+        const glm::vec3 fromScale(glm::length(glm::vec3(from[0])),
+            glm::length(glm::vec3(from[1])), glm::length(glm::vec3(from[2])));
+        const glm::vec3 toScale(glm::length(glm::vec3(to[0])),
+            glm::length(glm::vec3(to[1])), glm::length(glm::vec3(to[2])));
+        if (fromScale.x == 0.0f || fromScale.y == 0.0f || fromScale.z == 0.0f ||
+                toScale.x == 0.0f || toScale.y == 0.0f || toScale.z == 0.0f) {
+            // Degenerate transforms have no rotation to recover.
+            return from + (to - from) * alpha;
+        }
+        const glm::quat fromOrientation = glm::quat_cast(glm::mat3(glm::vec3(from[0]) / fromScale.x,
+            glm::vec3(from[1]) / fromScale.y, glm::vec3(from[2]) / fromScale.z));
+        const glm::quat toOrientation = glm::quat_cast(glm::mat3(glm::vec3(to[0]) / toScale.x,
+            glm::vec3(to[1]) / toScale.y, glm::vec3(to[2]) / toScale.z));
+
+        return composeTransform(
+            glm::mix(glm::vec3(from[3]), glm::vec3(to[3]), alpha),
+            glm::slerp(fromOrientation, toOrientation, alpha),
+            glm::mix(fromScale, toScale, alpha));
+    }
+
+    void multiplyTransform(const glm::mat4 &lhs, const glm::mat4 &rhs, glm::mat4 &out) {
+        multiplyColumns(&lhs[0][0], &rhs[0][0], &out[0][0]);
+    }
+
+    void multiplyTransforms(const glm::mat4 &lhs, const glm::mat4 *rhs,
+            glm::mat4 *out, std::size_t count) {
+        const float *left = &lhs[0][0];
+        for (std::size_t i = 0; i < count; i++) {
+            multiplyColumns(left, &rhs[i][0][0], &out[i][0][0]);
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include <cstddef>
+
+namespace scenegraphdemo {
+    // Returns the name of the instruction set the matrix kernels were built
+    // with ("avx", "sse" or "scalar").
+    const char *transformKernelIsa();
+
+    // Converts euler angles to the quaternion equivalent of applying
+    // rotate(y) * rotate(x) * rotate(z), which is the order nodes use.
+    glm::quat orientationFromEuler(const glm::vec3 &rotation);
+
+    // Converts a quaternion back to euler angles in the order used by
+    // orientationFromEuler.
+    glm::vec3 eulerFromOrientation(const glm::quat &orientation);
+
+    // Builds a translate * rotate * scale matrix directly from its components
+    // instead of multiplying separate matrices.
+    glm::mat4 composeTransform(
+        const glm::vec3 &position,
+        const glm::quat &orientation,
+        const glm::vec3 &scale);
+
+    // Blends two transforms made of a translation, a rotation and a scale,
+    // lerping translation and scale and slerping rotation, so rotating
+    // objects keep their shape in between. Shear isn't preserved. Alpha is
+    // clamped to [0, 1].
+    glm::mat4 interpolateTransform(const glm::mat4 &from, const glm::mat4 &to, float alpha);
+
+    // Computes out = lhs * rhs. The output may alias either input.
+    void multiplyTransform(const glm::mat4 &lhs, const glm::mat4 &rhs, glm::mat4 &out);
+
+    // Computes out[i] = lhs * rhs[i] for count matrices, such as when
+    // applying a view projection matrix to many world transforms. The output
+    // must not overlap lhs.
+    void multiplyTransforms(
+        const glm::mat4 &lhs,
+        const glm::mat4 *rhs,
+        glm::mat4 *out,
+        std::size_t count);
+}
@@ -0,0 +1,41 @@
+#include "nodes/frustum_culler.hpp"
+#include "nodes/node.hpp"
+
+namespace scenegraphdemo {
+    void FrustumCuller::cull(Node *root, const Frustum &frustum, std::vector<Node *> &visible) {
+        stats = CullStats();
+        visible.clear();
+
+        stack.clear();
+        stack.push_back(Pending{root, Frustum::ALL_PLANES});
+        while (!stack.empty()) {
+            Pending pending = stack.back();
+            stack.pop_back();
+            Node *node = pending.node;
+            stats.visited++;
+
+            // The sphere is cheaper to test and settles most subtrees that
+            // are far outside or deep inside. The box is only tested against
+            // the planes the sphere straddles.
+            std::uint8_t mask = pending.mask;
+            if (frustum.test(node->getSubtreeSphere(), mask) == Containment::OUTSIDE ||
+                    frustum.test(node->getSubtreeBounds(), mask) == Containment::OUTSIDE) {
+                stats.culled++;
+                continue;
+            }
+
+            std::uint8_t ownMask = mask;
+            if (frustum.test(node->getWorldBounds(), ownMask) != Containment::OUTSIDE) {
+                visible.push_back(node);
+            }
+            for (auto child : node->children) {
+                stack.push_back(Pending{child, mask});
+            }
+        }
+        stats.visible = visible.size();
+    }
+
+    const CullStats &FrustumCuller::getStats() const {
+        return stats;
+    }
+}
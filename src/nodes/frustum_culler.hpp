@@ -0,0 +1,47 @@
+#pragma once
+
+#include "math/bounds.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace scenegraphdemo {
+    class Node;
+
+    // Counters describing the work done by the last cull.
+    struct CullStats {
+        // Number of nodes whose subtree bounds were looked at.
+        std::size_t visited = 0;
+
+        // Number of subtrees rejected as a whole.
+        std::size_t culled = 0;
+
+        // Number of nodes found to be visible.
+        std::size_t visible = 0;
+    };
+
+    // Walks a scenegraph using the subtree bounds kept by the transform store
+    // and skips every subtree that lies entirely outside a frustum. Planes a
+    // subtree is fully inside of aren't tested again for its descendants.
+    // Only reads bounds, so world transforms must be updated beforehand.
+    class FrustumCuller {
+    public:
+        // Replaces the contents of visible with the nodes below root whose
+        // own bounds intersect the frustum. Nodes without bounds are never
+        // visible.
+        void cull(Node *root, const Frustum &frustum, std::vector<Node *> &visible);
+
+        // Returns the counters of the last cull.
+        const CullStats &getStats() const;
+    private:
+        // Node waiting to be visited and the planes its parent wasn't fully
+        // inside of.
+        struct Pending {
+            Node *node;
+            std::uint8_t mask;
+        };
+
+        std::vector<Pending> stack;
+        CullStats stats;
+    };
+}
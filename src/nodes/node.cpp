@@ -4,93 +4,100 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
 namespace scenegraphdemo {
     Node::Node(std::string name, glm::vec3 position, glm::vec3 rotation,
             glm::vec3 scale) {
         this->name = name;
-        this->position = position;
-        this->rotation = rotation;
-        this->scale = scale;
-        this->worldTransform = glm::mat4(1.0f);
-        this->localTransform = glm::mat4(1.0f);
+        this->transforms = TransformStore::getDefault();
+        this->slot = this->transforms->create(this, position, rotation, scale);
     }
 
     Node::~Node() {
-        scenegraphdemo::debug("Removing Node \"" + name + "\"");
+        scenegraphdemo::debug("Removing Node \"", name, "\"");
+
+        // Pools drop links before destroying nodes in bulk, so these fixups
+        // only happen for nodes torn down individually.
+        if (parent != nullptr) {
+            remove();
+        }
+        for (auto child : children) {
+            child->parent = nullptr;
+            transforms->setParent(child->slot, TransformStore::NO_PARENT);
+        }
+        this->transforms->destroy(this->slot);
     }
 
     void Node::update(float delta) {
     }
 
     void Node::updateWorldTransform() {
-        if (dirty) {
-            auto parent = this->parent.lock();
-            this->updateLocalTransform();
-            if (parent.get() != nullptr) {
-                worldTransform = parent.get()->worldTransform * localTransform;
-            } else {
-                worldTransform = glm::mat4(1.0f) * localTransform;
-            }
+        transforms->updateWorldTransforms(this);
+    }
 
-            dirty = false;
-            for (auto node : children) {
-                node.get()->markDirty();
-                node.get()->updateWorldTransform();
-            }
-        } else {
-            for (auto node : children) {
-                node.get()->updateWorldTransform();
-            }
-        }
+    void Node::updateWorldTransform(ThreadPool &pool, std::size_t grainSize) {
+        transforms->updateWorldTransforms(this, pool, grainSize);
     }
 
-    // TODO: Use quaternions as a substitute to euler angles to save on matrix
-    // multiplications (and to learn quaternions).
     void Node::updateLocalTransform() {
-        if (dirty) {
-            auto transform = glm::mat4(1.0f);
-            transform = glm::translate(transform, position);
-            transform = glm::rotate(transform, rotation.y, glm::vec3(0.0, 1.0, 0.0));
-            transform = glm::rotate(transform, rotation.x, glm::vec3(1.0, 0.0, 0.0));
-            transform = glm::rotate(transform, rotation.z, glm::vec3(0.0, 0.0, 1.0));
-            transform = glm::scale(transform, scale);
-            localTransform = transform;
-        }
+        transforms->updateLocalTransform(slot);
+    }
+
+    void Node::onWorldTransformChanged() {
     }
 
-    void Node::add(std::shared_ptr<Node> node) {
-        if (node) {
-            node.get()->parent = shared_from_this();
-            node.get()->dirty = true;
-            children.push_back(node);
+    void Node::add(Node *node) {
+        if (node == nullptr) {
+            return;
+        }
+        if (node->transforms != transforms) {
+            throw std::runtime_error("Cannot add \"" + node->name + "\" to \"" +
+                name + "\" as they use different transform stores");
+        }
+        for (auto ancestor = this; ancestor != nullptr; ancestor = ancestor->parent) {
+            if (ancestor == node) {
+                throw std::runtime_error("Cannot add \"" + node->name + "\" to \"" +
+                    name + "\" as it would create a cycle");
+            }
+        }
+
+        if (node->parent != nullptr) {
+            node->remove();
         }
+        node->parent = this;
+        transforms->setParent(node->slot, slot);
+        children.push_back(node);
     }
 
     void Node::remove() {
-        auto parent = this->parent.lock();
-        if (parent.get() == nullptr) {
-            scenegraphdemo::warn("Attempted to remove \"" + name + "\", but it has no parent");
+        if (parent == nullptr) {
+            scenegraphdemo::warn("Attempted to remove \"", name, "\", but it has no parent");
             return;
         }
 
-        auto it = std::find_if(parent.get()->children.begin(), parent.get()->children.end(), [this](auto i) {
-            return i.get() == this;
-        });
-        if (it != parent.get()->children.end()) {
-            parent.get()->children.erase(it); // Order matters so no swap.
+        auto &siblings = parent->children;
+        auto it = std::find(siblings.begin(), siblings.end(), this);
+        if (it != siblings.end()) {
+            siblings.erase(it); // Order matters so no swap.
         }
+        parent = nullptr;
+        transforms->setParent(slot, TransformStore::NO_PARENT);
+    }
+
+    NodeHandle Node::getHandle() const {
+        return handle;
     }
 
     void Node::markDirty() {
-        dirty = true;
+        transforms->markDirty(slot);
     }
 
     DecomposedTransform Node::getDecomposedTransform() {
         DecomposedTransform decomposed;
         glm::decompose(
-            worldTransform,
+            getWorldTransform(),
             decomposed.scale,
             decomposed.rotation,
             decomposed.translation,
@@ -100,30 +107,67 @@ namespace scenegraphdemo {
         return decomposed;
     }
 
+    const glm::mat4 &Node::getWorldTransform() const {
+        return transforms->worldTransforms[slot];
+    }
+
+    const glm::mat4 &Node::getPreviousWorldTransform() const {
+        return transforms->previousWorldTransforms[slot];
+    }
+
+    const glm::mat4 &Node::getLocalTransform() const {
+        return transforms->localTransforms[slot];
+    }
+
     glm::vec3 Node::getPos() const {
-        return position;
+        return transforms->positions[slot];
     }
 
     glm::vec3 Node::getRot() const {
-        return rotation;
+        return transforms->getRotation(slot);
+    }
+
+    glm::quat Node::getOrientation() const {
+        return transforms->orientations[slot];
     }
 
     glm::vec3 Node::getScale() const {
-        return scale;
+        return transforms->scales[slot];
     }
 
     void Node::setPos(glm::vec3 position) {
-        dirty = true;
-        this->position = position;
+        transforms->setPosition(slot, position);
     }
 
     void Node::setRot(glm::vec3 rotation) {
-        dirty = true;
-        this->rotation = rotation;
+        transforms->setRotation(slot, rotation);
+    }
+
+    void Node::setOrientation(glm::quat orientation) {
+        transforms->setOrientation(slot, orientation);
     }
 
     void Node::setScale(glm::vec3 scale) {
-        dirty = true;
-        this->scale = scale;
+        transforms->setScale(slot, scale);
+    }
+
+    void Node::setLocalBounds(const Aabb &bounds) {
+        transforms->setLocalBounds(slot, bounds);
+    }
+
+    const Aabb &Node::getLocalBounds() const {
+        return transforms->localBounds[slot];
+    }
+
+    const Aabb &Node::getWorldBounds() const {
+        return transforms->worldBounds[slot];
+    }
+
+    const Aabb &Node::getSubtreeBounds() const {
+        return transforms->subtreeBounds[slot];
+    }
+
+    const BoundingSphere &Node::getSubtreeSphere() const {
+        return transforms->subtreeSpheres[slot];
     }
 }
@@ -4,6 +4,10 @@
 
 #include "glm/glm.hpp"
 #include "glm/gtx/matrix_decompose.hpp"
+#include "nodes/node_pool.hpp"
+#include "nodes/transform_store.hpp"
+#include "rendering/renderable.hpp"
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
@@ -21,31 +25,31 @@ namespace scenegraphdemo {
         glm::vec4 perspective;
     };
 
-    class Node : public std::enable_shared_from_this<Node> {
+    // Nodes are usually allocated through a NodePool, which owns them. Links
+    // between nodes are plain pointers, so adding or traversing children
+    // doesn't touch reference counts.
+    class Node {
     public:
         // Reference to the node's parent.
-        std::weak_ptr<Node> parent;
+        Node *parent = nullptr;
 
         // Each node is and is part of an ordered tree that when traversed,
         // updates nodes at the top first and direct children in a first-come
         // first-serve basis.
         //
-        // One thing to note is cyclic references are not forbidden, but they
-        // should not stall the application as traversed nodes have a dirty
-        // check. Referencing the same node in different trees can lead to odd
-        // unexpected behavior in regards to coordinates and should be avoided.
-        std::vector<std::shared_ptr<Node>> children;
-
-        // World-space transformation for this node. This matrix is typically
-        // used when generating the world matrix of children nodes.
-        glm::mat4 worldTransform;
-
-        // Local-space transformation for this node.
-        glm::mat4 localTransform;
+        // A node can only have one parent, and adding it to another node moves
+        // it. Cyclic references are rejected.
+        std::vector<Node *> children;
 
         // Human-readable name used to describe the node's function.
         std::string name;
 
+        // Describes how the node is drawn, or nullptr if it isn't drawn. The
+        // renderable isn't owned by the node and is typically shared. Nodes
+        // are only drawn when their local bounds are set, as nodes without
+        // bounds are always culled.
+        const Renderable *renderable = nullptr;
+
         Node() : Node("Node") {}
         Node(std::string name) : Node(name, VEC3_ZERO) {}
         Node(std::string name, glm::vec3 position) :
@@ -60,56 +64,114 @@ namespace scenegraphdemo {
 
         virtual ~Node();
 
-        // Adds a another node as a direct child. The node will assume ownership
-        // of the node added as a child.
-        void add(std::shared_ptr<Node> node);
+        // Nodes own a slot in their transform store, so they can't be copied.
+        Node(const Node &) = delete;
+        Node &operator=(const Node &) = delete;
+
+        // Adds a another node as a direct child, detaching it from its
+        // previous parent first. Ownership stays with the node's pool, which
+        // destroys children along with their parent.
+        void add(Node *node);
 
         // Removes the node from it's parent tree.
         void remove();
 
-        // Traverses the tree and updates child transformations.
-        virtual void updateWorldTransform();
+        // Returns the handle of the node in its pool. The handle is invalid
+        // for nodes that weren't allocated by a pool.
+        NodeHandle getHandle() const;
+
+        // Updates the transformations of this node and its descendants in a
+        // single linear sweep over the transform store.
+        void updateWorldTransform();
+
+        // Same as above, but spreads the sweep over a thread pool in tasks of
+        // at least grainSize nodes. Results are identical to the serial path.
+        void updateWorldTransform(
+            ThreadPool &pool,
+            std::size_t grainSize = TransformStore::DEFAULT_GRAIN_SIZE);
 
         // Recreates the local-space transform based on pos, rot, and scale.
-        virtual void updateLocalTransform();
+        void updateLocalTransform();
 
         DecomposedTransform getDecomposedTransform();
 
+        // Returns the world-space transformation for this node. This matrix is
+        // typically used when generating the world matrix of children nodes.
+        const glm::mat4 &getWorldTransform() const;
+
+        // Returns the world-space transformation for this node as of the last
+        // TransformStore::savePreviousWorldTransforms call. Nodes created
+        // since then return their first world transform.
+        const glm::mat4 &getPreviousWorldTransform() const;
+
+        // Returns the local-space transformation for this node.
+        const glm::mat4 &getLocalTransform() const;
+
         // Returns the node's position in local-space.
         glm::vec3 getPos() const;
 
-        // Returns the node's rotation in local-space.
+        // Returns the node's rotation in local-space as euler angles.
         glm::vec3 getRot() const;
 
+        // Returns the node's rotation in local-space as a quaternion.
+        glm::quat getOrientation() const;
+
         // Returns the node's scale in local-space.
         glm::vec3 getScale() const;
 
         // Sets the node's position in local-space.
         void setPos(glm::vec3 position);
 
-        // Sets the node's rotation in local-space.
+        // Sets the node's rotation in local-space from euler angles, applied
+        // in y, x, z order.
         void setRot(glm::vec3 rotation);
 
+        // Sets the node's rotation in local-space from a quaternion, which is
+        // used as-is to build the local transform.
+        void setOrientation(glm::quat orientation);
+
         // Sets the node's scale in local-space.
         void setScale(glm::vec3 scale);
 
+        // Sets the bounds of the node's own content in local-space.
+        void setLocalBounds(const Aabb &bounds);
+
+        // Returns the bounds of the node's own content in local-space.
+        const Aabb &getLocalBounds() const;
+
+        // Returns the bounds of the node's own content in world-space as of
+        // the last world transform update.
+        const Aabb &getWorldBounds() const;
+
+        // Returns the world-space bounds enclosing the node and all of its
+        // descendants, as a box and as a sphere.
+        const Aabb &getSubtreeBounds() const;
+        const BoundingSphere &getSubtreeSphere() const;
+
         // Sets the diry flag for the node so transforms are updated later.
         void markDirty();
 
         // Runs the node's update function which can vary due to inheritance.
         virtual void update(float delta);
     protected:
-        // Position of the node in local-space.
-        glm::vec3 position;
+        // Store holding the node's position, rotation, scale and matrices.
+        std::shared_ptr<TransformStore> transforms;
 
-        // Rotation of the node in local-space.
-        glm::vec3 rotation;
+        // Index of the node's slot in the transform store. The store keeps
+        // this up to date when it reorders slots.
+        std::size_t slot;
 
-        // Scale of the node in local-space.
-        glm::vec3 scale;
+        // Pool owning the node, or nullptr when allocated elsewhere.
+        NodePool *pool = nullptr;
+
+        // Handle of the node in its pool.
+        NodeHandle handle;
 
-        // Dirty flag used to speed up tree traversal and prevent cyclic loops.
-        // This flag will be set when the transform is changed.
-        bool dirty = true;
+        // Called by the transform store after the world transform of the node
+        // was rebuilt, provided the node registered itself as a listener.
+        virtual void onWorldTransformChanged();
+    private:
+        friend class NodePool;
+        friend class TransformStore;
     };
 }
@@ -0,0 +1,188 @@
+#include "nodes/node.hpp"
+#include "nodes/node_pool.hpp"
+#include <algorithm>
+
+namespace scenegraphdemo {
+    constexpr std::size_t NodePool::DEFAULT_CHUNK_SIZE;
+
+    NodeArena::NodeArena(std::size_t slotSize, std::size_t slotsPerChunk) {
+        // Slots are rounded up so every one of them stays suitably aligned
+        // and can hold a free list link.
+        const std::size_t alignment = alignof(std::max_align_t);
+        slotSize = std::max(slotSize, sizeof(void *));
+        this->slotSize = (slotSize + alignment - 1) / alignment * alignment;
+        this->slotsPerChunk = std::max<std::size_t>(slotsPerChunk, 1);
+        this->used = this->slotsPerChunk;
+    }
+
+    NodeArena::~NodeArena() {
+        release();
+    }
+
+    void *NodeArena::allocate() {
+        if (freeList != nullptr) {
+            void *memory = freeList;
+            freeList = *static_cast<void **>(memory);
+            return memory;
+        }
+
+        if (used == slotsPerChunk) {
+            chunks.push_back(static_cast<char *>(::operator new(slotSize * slotsPerChunk)));
+            used = 0;
+        }
+        return chunks.back() + slotSize * used++;
+    }
+
+    void NodeArena::deallocate(void *memory) {
+        *static_cast<void **>(memory) = freeList;
+        freeList = memory;
+    }
+
+    void NodeArena::release() {
+        for (auto chunk : chunks) {
+            ::operator delete(chunk);
+        }
+        chunks.clear();
+        used = slotsPerChunk;
+        freeList = nullptr;
+    }
+
+    NodePool::NodePool(std::size_t chunkSize) {
+        this->chunkSize = chunkSize;
+    }
+
+    NodePool::~NodePool() {
+        clear();
+    }
+
+    Node *NodePool::get(NodeHandle handle) const {
+        if (handle.index >= entries.size()) {
+            return nullptr;
+        }
+        const Entry &entry = entries[handle.index];
+        if (entry.generation != handle.generation) {
+            return nullptr;
+        }
+        return entry.node;
+    }
+
+    void NodePool::destroy(NodeHandle handle) {
+        Node *root = get(handle);
+        if (root == nullptr) {
+            return;
+        }
+        if (root->parent != nullptr) {
+            root->remove();
+        }
+
+        // Gather the subtree first so links can be dropped without fixing up
+        // every parent's child list one node at a time. Children owned by
+        // something else are only detached.
+        std::vector<Node *> subtree = {root};
+        for (std::size_t i = 0; i < subtree.size(); i++) {
+            for (auto child : subtree[i]->children) {
+                if (child->pool == this) {
+                    subtree.push_back(child);
+                } else {
+                    child->parent = nullptr;
+                    child->transforms->setParent(child->slot, TransformStore::NO_PARENT);
+                }
+            }
+        }
+        for (auto node : subtree) {
+            node->parent = nullptr;
+            node->children.clear();
+        }
+        for (auto node : subtree) {
+            release(node->handle.index);
+        }
+    }
+
+    void NodePool::clear() {
+        // Only links crossing into nodes owned elsewhere need real fixups.
+        for (auto &entry : entries) {
+            Node *node = entry.node;
+            if (node == nullptr) {
+                continue;
+            }
+            if (node->parent != nullptr && node->parent->pool != this) {
+                node->remove();
+            }
+            for (auto child : node->children) {
+                if (child->pool != this) {
+                    child->parent = nullptr;
+                    child->transforms->setParent(child->slot, TransformStore::NO_PARENT);
+                }
+            }
+        }
+        for (auto &entry : entries) {
+            if (entry.node != nullptr) {
+                entry.node->parent = nullptr;
+                entry.node->children.clear();
+            }
+        }
+
+        freeEntries.clear();
+        for (std::uint32_t i = 0; i < entries.size(); i++) {
+            Entry &entry = entries[i];
+            if (entry.node != nullptr) {
+                entry.node->~Node();
+                entry.node = nullptr;
+                entry.memory = nullptr;
+                entry.arena = nullptr;
+                entry.generation++;
+            }
+            freeEntries.push_back(i);
+        }
+        // Hand out low indices first once entries are reused.
+        std::reverse(freeEntries.begin(), freeEntries.end());
+
+        for (auto &arena : arenas) {
+            arena.second->release();
+        }
+        liveCount = 0;
+    }
+
+    std::size_t NodePool::size() const {
+        return liveCount;
+    }
+
+    NodeArena &NodePool::getArena(const std::type_info &type, std::size_t size) {
+        auto &arena = arenas[std::type_index(type)];
+        if (!arena) {
+            arena.reset(new NodeArena(size, chunkSize));
+        }
+        return *arena;
+    }
+
+    void NodePool::track(Node *node, void *memory, NodeArena &arena) {
+        std::uint32_t index;
+        if (!freeEntries.empty()) {
+            index = freeEntries.back();
+            freeEntries.pop_back();
+        } else {
+            index = static_cast<std::uint32_t>(entries.size());
+            entries.push_back(Entry{nullptr, nullptr, nullptr, 0});
+        }
+
+        Entry &entry = entries[index];
+        entry.node = node;
+        entry.memory = memory;
+        entry.arena = &arena;
+        node->pool = this;
+        node->handle = NodeHandle{index, entry.generation};
+        liveCount++;
+    }
+
+    void NodePool::release(std::uint32_t index) {
+        Entry &entry = entries[index];
+        entry.node->~Node();
+        entry.arena->deallocate(entry.memory);
+        entry.node = nullptr;
+        entry.memory = nullptr;
+        entry.arena = nullptr;
+        entry.generation++;
+        freeEntries.push_back(index);
+        liveCount--;
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace scenegraphdemo {
+    class Node;
+
+    // Generational reference to a node allocated by a NodePool. A handle goes
+    // stale once its node is destroyed, even if the pool reuses the memory
+    // and index for another node.
+    struct NodeHandle {
+        std::uint32_t index = UINT32_MAX;
+        std::uint32_t generation = 0;
+
+        bool operator==(const NodeHandle &other) const {
+            return index == other.index && generation == other.generation;
+        }
+
+        bool operator!=(const NodeHandle &other) const {
+            return !(*this == other);
+        }
+    };
+
+    // Fixed-size slot allocator carving objects out of large chunks. Freed
+    // slots are kept on an intrusive free list for reuse.
+    class NodeArena {
+    public:
+        NodeArena(std::size_t slotSize, std::size_t slotsPerChunk);
+        ~NodeArena();
+
+        NodeArena(const NodeArena &) = delete;
+        NodeArena &operator=(const NodeArena &) = delete;
+
+        // Returns uninitialized memory for one object.
+        void *allocate();
+
+        // Returns memory of a destroyed object to the free list.
+        void deallocate(void *memory);
+
+        // Releases every chunk at once. Objects must already be destroyed.
+        void release();
+    private:
+        std::size_t slotSize;
+        std::size_t slotsPerChunk;
+        std::vector<char *> chunks;
+
+        // Number of slots handed out from the newest chunk.
+        std::size_t used;
+
+        // Head of the list of freed slots, linked through their memory.
+        void *freeList = nullptr;
+    };
+
+    // Owns nodes allocated from per-type arenas, so spawning and despawning
+    // nodes doesn't hit the general-purpose allocator or reference counts.
+    // Nodes link to each other through plain pointers, and the pool is the
+    // only owner: destroying a node destroys its subtree, and clearing or
+    // destroying the pool tears every node down in bulk.
+    class NodePool {
+    public:
+        // Number of objects per arena chunk.
+        static constexpr std::size_t DEFAULT_CHUNK_SIZE = 256;
+
+        NodePool(std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+        ~NodePool();
+
+        NodePool(const NodePool &) = delete;
+        NodePool &operator=(const NodePool &) = delete;
+
+        // Constructs a node of type T in the pool. The pointer stays valid
+        // until the node is destroyed.
+        template <typename T, typename... Args>
+        T *create(Args &&... args) {
+            static_assert(std::is_base_of<Node, T>::value, "NodePool can only hold nodes");
+            static_assert(alignof(T) <= alignof(std::max_align_t), "Node type is over-aligned");
+
+            NodeArena &arena = getArena(typeid(T), sizeof(T));
+            void *memory = arena.allocate();
+            T *node;
+            try {
+                node = new (memory) T(std::forward<Args>(args)...);
+            } catch (...) {
+                arena.deallocate(memory);
+                throw;
+            }
+            track(node, memory, arena);
+            return node;
+        }
+
+        // Returns the node referenced by a handle, or nullptr if the handle
+        // is stale or came from another pool.
+        Node *get(NodeHandle handle) const;
+
+        // Same as above, but casts to a derived node type.
+        template <typename T>
+        T *get(NodeHandle handle) const {
+            return static_cast<T *>(get(handle));
+        }
+
+        // Detaches a node from its parent and destroys it along with all of
+        // its descendants owned by this pool. Stale handles are ignored.
+        void destroy(NodeHandle handle);
+
+        // Destroys every node in the pool at once. Links between nodes are
+        // dropped without per-node tree fixups, and arena memory is released
+        // wholesale.
+        void clear();
+
+        // Returns the number of live nodes.
+        std::size_t size() const;
+    private:
+        struct Entry {
+            Node *node;
+            void *memory;
+            NodeArena *arena;
+            std::uint32_t generation;
+        };
+
+        std::size_t chunkSize;
+        std::vector<Entry> entries;
+        std::vector<std::uint32_t> freeEntries;
+        std::unordered_map<std::type_index, std::unique_ptr<NodeArena>> arenas;
+        std::size_t liveCount = 0;
+
+        // Returns the arena used for a node type, creating it if needed.
+        NodeArena &getArena(const std::type_info &type, std::size_t size);
+
+        // Assigns a handle to a freshly constructed node.
+        void track(Node *node, void *memory, NodeArena &arena);
+
+        // Destroys a node whose links were already dropped and frees its
+        // handle and memory.
+        void release(std::uint32_t index);
+    };
+}
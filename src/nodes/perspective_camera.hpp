@@ -31,9 +31,10 @@ namespace scenegraphdemo {
             float near,
             float far);
 
-        // Traverses the tree and updates child transformations, and in addition
-        // the view projection matrix as well.
-        virtual void updateWorldTransform();
+    protected:
+        // Rebuilds the view projection matrix whenever the camera's world
+        // transform changes.
+        virtual void onWorldTransformChanged();
     private:
         glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
         glm::vec3 right = glm::vec3(1.0f, 0.0f, 0.0f);
@@ -0,0 +1,458 @@
+#include "math/transform_kernels.hpp"
+#include "nodes/node.hpp"
+#include "nodes/transform_store.hpp"
+#include "profiling/profiler.hpp"
+#include "threading/thread_pool.hpp"
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <type_traits>
+
+namespace scenegraphdemo {
+    constexpr std::size_t TransformStore::NO_PARENT;
+    constexpr std::size_t TransformStore::DEFAULT_GRAIN_SIZE;
+
+    TransformStore::TransformStore() {
+    }
+
+    std::shared_ptr<TransformStore> TransformStore::getDefault() {
+        static std::shared_ptr<TransformStore> store = std::make_shared<TransformStore>();
+        return store;
+    }
+
+    std::size_t TransformStore::create(Node *owner, glm::vec3 position,
+            glm::vec3 rotation, glm::vec3 scale) {
+        // New slots are roots with no children, so appending them keeps the
+        // layout valid without a rebuild.
+        std::size_t slot = owners.size();
+        positions.push_back(position);
+        rotations.push_back(rotation);
+        orientations.push_back(orientationFromEuler(rotation));
+        rotationModes.push_back(RotationMode::EULER);
+        scales.push_back(scale);
+        localTransforms.push_back(glm::mat4(1.0f));
+        worldTransforms.push_back(glm::mat4(1.0f));
+        previousWorldTransforms.push_back(glm::mat4(1.0f));
+        localBounds.push_back(Aabb());
+        worldBounds.push_back(Aabb());
+        subtreeBounds.push_back(Aabb());
+        subtreeSpheres.push_back(BoundingSphere());
+        parents.push_back(NO_PARENT);
+        subtreeSizes.push_back(1);
+        dirty.push_back(1);
+        dirtyDescendants.push_back(0);
+        owners.push_back(owner);
+        listeners.push_back(0);
+        previousStates.push_back(PREVIOUS_NEW);
+        updated.push_back(0);
+        boundsStale.push_back(0);
+        return slot;
+    }
+
+    void TransformStore::destroy(std::size_t slot) {
+        // The parent's subtree bounds no longer include this slot.
+        if (parents[slot] != NO_PARENT) {
+            markBoundsDirty(parents[slot]);
+        }
+
+        // Released slots are compacted away on the next layout rebuild.
+        owners[slot] = nullptr;
+        parents[slot] = NO_PARENT;
+        listeners[slot] = 0;
+        layoutDirty = true;
+    }
+
+    void TransformStore::setParent(std::size_t slot, std::size_t parent) {
+        if (parents[slot] != NO_PARENT) {
+            markBoundsDirty(parents[slot]);
+        }
+        parents[slot] = parent;
+        layoutDirty = true;
+        markDirty(slot);
+    }
+
+    void TransformStore::markDirty(std::size_t slot) {
+        dirty[slot] = 1;
+        // Ancestors above a marked slot are already marked, which also stops
+        // the walk when slots form a cycle.
+        std::size_t parent = parents[slot];
+        while (parent != NO_PARENT && !dirtyDescendants[parent]) {
+            dirtyDescendants[parent] = 1;
+            parent = parents[parent];
+        }
+    }
+
+    void TransformStore::markBoundsDirty(std::size_t slot) {
+        // A slot flagged as having dirty descendants is visited by the next
+        // sweep without being rebuilt, which is enough to refresh its bounds.
+        while (slot != NO_PARENT && !dirtyDescendants[slot]) {
+            dirtyDescendants[slot] = 1;
+            slot = parents[slot];
+        }
+    }
+
+    void TransformStore::setPosition(std::size_t slot, glm::vec3 position) {
+        positions[slot] = position;
+        markDirty(slot);
+    }
+
+    void TransformStore::setScale(std::size_t slot, glm::vec3 scale) {
+        scales[slot] = scale;
+        markDirty(slot);
+    }
+
+    void TransformStore::setLocalBounds(std::size_t slot, const Aabb &bounds) {
+        localBounds[slot] = bounds;
+        markDirty(slot);
+    }
+
+    void TransformStore::setListener(std::size_t slot, bool listener) {
+        listeners[slot] = listener ? 1 : 0;
+    }
+
+    void TransformStore::updateWorldTransforms() {
+        if (layoutDirty) {
+            rebuildLayout();
+        }
+        sweep(0, owners.size(), 0);
+        updateBounds(0, owners.size());
+    }
+
+    void TransformStore::updateWorldTransforms(const Node *root) {
+        if (layoutDirty) {
+            rebuildLayout();
+        }
+        // The root's slot may have moved during the rebuild, so it's read
+        // only afterwards.
+        std::size_t begin = root->slot;
+        sweep(begin, begin + subtreeSizes[begin], begin);
+        updateBounds(begin, begin + subtreeSizes[begin]);
+    }
+
+    void TransformStore::updateWorldTransforms(const Node *root,
+            ThreadPool &pool, std::size_t grainSize) {
+        if (layoutDirty) {
+            rebuildLayout();
+        }
+        std::size_t begin = root->slot;
+        if (!needsVisit(begin, begin)) {
+            return;
+        }
+        if (subtreeSizes[begin] <= grainSize) {
+            sweep(begin, begin + subtreeSizes[begin], begin);
+        } else {
+            TaskGroup group;
+            sweepParallel(begin, begin, pool, group, std::max<std::size_t>(grainSize, 1));
+            pool.wait(group);
+        }
+
+        // Bounds flow from children to parents, which doesn't split into
+        // independent subtrees as well, so they're gathered on this thread.
+        ProfileScope scope("bounds");
+        updateBounds(begin, begin + subtreeSizes[begin]);
+    }
+
+    void TransformStore::savePreviousWorldTransforms() {
+        // Slots that weren't rebuilt since the last save already hold their
+        // current transform.
+        for (auto slot : changedSlots) {
+            previousWorldTransforms[slot] = worldTransforms[slot];
+            previousStates[slot] = PREVIOUS_CURRENT;
+        }
+        changedSlots.clear();
+    }
+
+    void TransformStore::updateLocalTransform(std::size_t slot) {
+        localTransforms[slot] = composeTransform(positions[slot], orientations[slot], scales[slot]);
+    }
+
+    void TransformStore::setRotation(std::size_t slot, glm::vec3 rotation) {
+        rotations[slot] = rotation;
+        orientations[slot] = orientationFromEuler(rotation);
+        rotationModes[slot] = RotationMode::EULER;
+        markDirty(slot);
+    }
+
+    void TransformStore::setOrientation(std::size_t slot, glm::quat orientation) {
+        orientations[slot] = glm::normalize(orientation);
+        rotationModes[slot] = RotationMode::QUATERNION;
+        markDirty(slot);
+    }
+
+    glm::vec3 TransformStore::getRotation(std::size_t slot) const {
+        if (rotationModes[slot] == RotationMode::QUATERNION) {
+            return eulerFromOrientation(orientations[slot]);
+        }
+        return rotations[slot];
+    }
+
+    std::size_t TransformStore::size() const {
+        return owners.size();
+    }
+
+    void TransformStore::sweep(std::size_t begin, std::size_t end,
+            std::size_t boundary) {
+        std::size_t i = begin;
+        while (i < end) {
+            if (needsVisit(i, boundary)) {
+                updateSlot(i, boundary);
+                i++;
+            } else {
+                i += subtreeSizes[i];
+            }
+        }
+    }
+
+    bool TransformStore::needsVisit(std::size_t slot, std::size_t boundary) const {
+        std::size_t parent = parents[slot];
+        return dirty[slot] || dirtyDescendants[slot] ||
+            (parent != NO_PARENT && parent >= boundary && updated[parent]);
+    }
+
+    void TransformStore::updateSlot(std::size_t slot, std::size_t boundary) {
+        // The caller visits every child next, so the descendant flag can be
+        // cleared up front.
+        dirtyDescendants[slot] = 0;
+        boundsStale[slot] = 1;
+
+        // A slot is rebuilt when it's dirty itself or when its parent was
+        // rebuilt earlier in this update.
+        std::size_t parent = parents[slot];
+        bool parentUpdated = parent != NO_PARENT && parent >= boundary && updated[parent];
+        if (!dirty[slot] && !parentUpdated) {
+            updated[slot] = 0;
+            return;
+        }
+
+        // Keep the transform the step started from. Each slot is written by
+        // one task at a time, so this is safe in parallel updates.
+        if (previousStates[slot] == PREVIOUS_CURRENT) {
+            previousWorldTransforms[slot] = worldTransforms[slot];
+            previousStates[slot] = PREVIOUS_SAVED;
+        }
+
+        updateLocalTransform(slot);
+        if (parent != NO_PARENT) {
+            multiplyTransform(worldTransforms[parent], localTransforms[slot], worldTransforms[slot]);
+        } else {
+            worldTransforms[slot] = localTransforms[slot];
+        }
+        if (previousStates[slot] == PREVIOUS_NEW) {
+            previousWorldTransforms[slot] = worldTransforms[slot];
+            previousStates[slot] = PREVIOUS_CURRENT;
+        }
+        dirty[slot] = 0;
+        updated[slot] = 1;
+
+        if (listeners[slot]) {
+            owners[slot]->onWorldTransformChanged();
+        }
+    }
+
+    void TransformStore::updateBounds(std::size_t begin, std::size_t end) {
+        // Stale slots form paths down from begin, so clean subtrees can be
+        // skipped the same way the sweep does.
+        boundsOrder.clear();
+        std::size_t i = begin;
+        while (i < end) {
+            if (boundsStale[i]) {
+                boundsOrder.push_back(i);
+                i++;
+            } else {
+                i += subtreeSizes[i];
+            }
+        }
+        for (auto it = boundsOrder.rbegin(); it != boundsOrder.rend(); ++it) {
+            updateSlotBounds(*it);
+            boundsStale[*it] = 0;
+            if (previousStates[*it] == PREVIOUS_SAVED) {
+                previousStates[*it] = PREVIOUS_LISTED;
+                changedSlots.push_back(*it);
+            }
+        }
+
+        // Ancestors of a subtree root sit outside the range but enclose it.
+        if (boundsOrder.empty() || boundsOrder.front() != begin) {
+            return;
+        }
+        for (std::size_t slot = parents[begin]; slot != NO_PARENT; slot = parents[slot]) {
+            updateSlotBounds(slot);
+        }
+    }
+
+    void TransformStore::updateSlotBounds(std::size_t slot) {
+        worldBounds[slot] = transformBounds(worldTransforms[slot], localBounds[slot]);
+
+        // Children are the contiguous subtrees following the slot.
+        Aabb bounds = worldBounds[slot];
+        const std::size_t end = slot + subtreeSizes[slot];
+        for (std::size_t child = slot + 1; child < end; child += subtreeSizes[child]) {
+            bounds = mergeBounds(bounds, subtreeBounds[child]);
+        }
+        subtreeBounds[slot] = bounds;
+        subtreeSpheres[slot] = sphereFromBounds(bounds);
+    }
+
+    void TransformStore::sweepParallel(std::size_t root, std::size_t boundary,
+            ThreadPool &pool, TaskGroup &group, std::size_t grainSize) {
+        updateSlot(root, boundary);
+
+        // Children of the root are contiguous subtrees following it. Large
+        // ones become tasks of their own, while small ones are gathered into
+        // runs of roughly grainSize slots so wide, shallow trees split too.
+        // Large subtrees with nothing to update are skipped outright.
+        const std::size_t end = root + subtreeSizes[root];
+        std::size_t child = root + 1;
+        std::size_t runBegin = child;
+        auto submitRun = [&](std::size_t runEnd) {
+            if (runBegin < runEnd) {
+                pool.submit(group, [this, runBegin, runEnd, boundary] {
+                    ProfileScope scope("sweep");
+                    sweep(runBegin, runEnd, boundary);
+                });
+            }
+            runBegin = runEnd;
+        };
+        while (child < end) {
+            const std::size_t size = subtreeSizes[child];
+            if (size >= grainSize) {
+                submitRun(child);
+                if (needsVisit(child, boundary)) {
+                    pool.submit(group, [this, child, boundary, &pool, &group, grainSize] {
+                        sweepParallel(child, boundary, pool, group, grainSize);
+                    });
+                }
+                child += size;
+                runBegin = child;
+            } else {
+                child += size;
+                if (child - runBegin >= grainSize) {
+                    submitRun(child);
+                }
+            }
+        }
+        sweep(runBegin, end, boundary);
+    }
+
+    void TransformStore::rebuildLayout() {
+        const std::size_t count = owners.size();
+
+        // Bucket live slots by parent so children can be visited in slot
+        // order during the traversal below.
+        std::vector<std::size_t> childOffsets(count + 1, 0);
+        for (std::size_t i = 0; i < count; i++) {
+            if (owners[i] != nullptr && parents[i] != NO_PARENT) {
+                childOffsets[parents[i] + 1]++;
+            }
+        }
+        for (std::size_t i = 0; i < count; i++) {
+            childOffsets[i + 1] += childOffsets[i];
+        }
+        std::vector<std::size_t> childSlots(childOffsets[count]);
+        std::vector<std::size_t> cursor(childOffsets.begin(), childOffsets.end() - 1);
+        for (std::size_t i = 0; i < count; i++) {
+            if (owners[i] != nullptr && parents[i] != NO_PARENT) {
+                childSlots[cursor[parents[i]]++] = i;
+            }
+        }
+
+        // Depth-first traversal from every root produces the new order.
+        std::vector<std::size_t> order;
+        order.reserve(count);
+        std::vector<std::uint8_t> visited(count, 0);
+        std::vector<std::size_t> stack;
+        auto visit = [&](std::size_t root) {
+            stack.push_back(root);
+            while (!stack.empty()) {
+                std::size_t slot = stack.back();
+                stack.pop_back();
+                if (visited[slot]) {
+                    continue;
+                }
+                visited[slot] = 1;
+                order.push_back(slot);
+                // Push in reverse so children are visited in slot order.
+                for (std::size_t c = childOffsets[slot + 1]; c > childOffsets[slot]; c--) {
+                    stack.push_back(childSlots[c - 1]);
+                }
+            }
+        };
+        for (std::size_t i = 0; i < count; i++) {
+            if (owners[i] != nullptr && parents[i] == NO_PARENT) {
+                visit(i);
+            }
+        }
+
+        // Slots whose parent was released, or that are part of a cycle, are
+        // unreachable from any root. They are detached and kept as roots so
+        // the sweep never loops.
+        for (std::size_t i = 0; i < count; i++) {
+            if (owners[i] != nullptr && !visited[i]) {
+                parents[i] = NO_PARENT;
+                visit(i);
+            }
+        }
+
+        std::vector<std::size_t> remap(count, NO_PARENT);
+        for (std::size_t i = 0; i < order.size(); i++) {
+            remap[order[i]] = i;
+        }
+
+        auto permute = [&order](auto &values) {
+            typename std::remove_reference<decltype(values)>::type sorted;
+            sorted.reserve(order.size());
+            for (auto slot : order) {
+                sorted.push_back(values[slot]);
+            }
+            // Copied back instead of swapped, so the arrays keep their
+            // capacity and slots created after a teardown reuse it.
+            values.assign(sorted.begin(), sorted.end());
+        };
+        permute(positions);
+        permute(rotations);
+        permute(orientations);
+        permute(rotationModes);
+        permute(scales);
+        permute(localTransforms);
+        permute(worldTransforms);
+        permute(previousWorldTransforms);
+        permute(localBounds);
+        permute(worldBounds);
+        permute(subtreeBounds);
+        permute(subtreeSpheres);
+        permute(parents);
+        permute(dirty);
+        permute(dirtyDescendants);
+        permute(owners);
+        permute(listeners);
+        permute(previousStates);
+        updated.assign(order.size(), 0);
+        boundsStale.assign(order.size(), 0);
+
+        for (std::size_t i = 0; i < order.size(); i++) {
+            if (parents[i] != NO_PARENT) {
+                parents[i] = remap[parents[i]];
+            }
+            owners[i]->slot = i;
+        }
+
+        // Released slots have nothing left to catch up.
+        std::size_t kept = 0;
+        for (auto slot : changedSlots) {
+            if (remap[slot] != NO_PARENT) {
+                changedSlots[kept++] = remap[slot];
+            }
+        }
+        changedSlots.resize(kept);
+
+        // Descendants always follow their parent, so a reverse pass can
+        // accumulate subtree sizes.
+        subtreeSizes.assign(order.size(), 1);
+        for (std::size_t i = order.size(); i-- > 0;) {
+            if (parents[i] != NO_PARENT) {
+                subtreeSizes[parents[i]] += subtreeSizes[i];
+            }
+        }
+
+        layoutDirty = false;
+    }
+}
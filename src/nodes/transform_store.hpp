@@ -0,0 +1,268 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "math/bounds.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace scenegraphdemo {
+    class Node;
+    class ThreadPool;
+    struct TaskGroup;
+
+    // Describes which representation of a slot's rotation was last set and
+    // is therefore authoritative. Local transforms are always built from the
+    // quaternion, which is kept in sync when euler angles are set.
+    enum class RotationMode : std::uint8_t {
+        EULER,
+        QUATERNION,
+    };
+
+    // Structure-of-arrays storage for node transforms. Every node owns a slot
+    // in a store and acts as a handle to it. Slots are kept in depth-first
+    // order so parents always come before their children, and the descendants
+    // of a slot occupy the contiguous range following it. This lets world
+    // transforms be computed in a single linear sweep over the arrays instead
+    // of recursing through the node tree.
+    class TransformStore {
+    public:
+        // Parent index used by slots that are at the root of a tree.
+        static constexpr std::size_t NO_PARENT = SIZE_MAX;
+
+        // Default minimum number of slots handed to a single task by the
+        // parallel update.
+        static constexpr std::size_t DEFAULT_GRAIN_SIZE = 1024;
+
+        // Position of each slot in local-space.
+        std::vector<glm::vec3> positions;
+
+        // Rotation of each slot in local-space as euler angles. Only valid for
+        // slots using RotationMode::EULER.
+        std::vector<glm::vec3> rotations;
+
+        // Rotation of each slot in local-space as a unit quaternion.
+        std::vector<glm::quat> orientations;
+
+        // Authoritative rotation representation of each slot.
+        std::vector<RotationMode> rotationModes;
+
+        // Scale of each slot in local-space.
+        std::vector<glm::vec3> scales;
+
+        // Local-space transformation for each slot.
+        std::vector<glm::mat4> localTransforms;
+
+        // World-space transformation for each slot.
+        std::vector<glm::mat4> worldTransforms;
+
+        // World-space transformation for each slot as of the last call to
+        // savePreviousWorldTransforms, used to interpolate between steps.
+        // Slots that weren't rebuilt since then hold their current transform.
+        std::vector<glm::mat4> previousWorldTransforms;
+
+        // Bounds of each slot's own content in local-space. Empty for slots
+        // with nothing to draw.
+        std::vector<Aabb> localBounds;
+
+        // Bounds of each slot's own content in world-space.
+        std::vector<Aabb> worldBounds;
+
+        // World-space bounds of each slot's content together with everything
+        // below it, as a box and as the sphere enclosing that box. These let
+        // whole subtrees be rejected with a single test.
+        std::vector<Aabb> subtreeBounds;
+        std::vector<BoundingSphere> subtreeSpheres;
+
+        // Index of each slot's parent, or NO_PARENT for roots.
+        std::vector<std::size_t> parents;
+
+        // Number of slots in each slot's subtree (including itself). The
+        // subtree of slot i spans [i, i + subtreeSizes[i]).
+        std::vector<std::size_t> subtreeSizes;
+
+        // Set when a slot's local transform needs to be rebuilt.
+        std::vector<std::uint8_t> dirty;
+
+        // Set when some slot below this one is dirty. Sweeps skip subtrees
+        // that have neither flag set, so a frame where little moved only
+        // costs as much as the paths leading to the changed slots.
+        std::vector<std::uint8_t> dirtyDescendants;
+
+        // Node that owns each slot, or nullptr for released slots.
+        std::vector<Node *> owners;
+
+        TransformStore();
+
+        TransformStore(const TransformStore &) = delete;
+        TransformStore &operator=(const TransformStore &) = delete;
+
+        // Returns the store used by nodes that aren't given one explicitly.
+        static std::shared_ptr<TransformStore> getDefault();
+
+        // Allocates a root slot for a node and returns its index. The index
+        // changes whenever the layout is rebuilt, and the owner's slot is
+        // updated to match when that happens.
+        std::size_t create(
+            Node *owner,
+            glm::vec3 position,
+            glm::vec3 rotation,
+            glm::vec3 scale);
+
+        // Releases a slot. Children of the slot become roots.
+        void destroy(std::size_t slot);
+
+        // Reparents a slot, or makes it a root when parent is NO_PARENT.
+        void setParent(std::size_t slot, std::size_t parent);
+
+        // Flags a slot for rebuilding and marks its ancestors as having a
+        // dirty descendant. Stops early at the first ancestor already marked.
+        void markDirty(std::size_t slot);
+
+        // Marks a slot as having stale subtree bounds without rebuilding its
+        // transform, along with its ancestors.
+        void markBoundsDirty(std::size_t slot);
+
+        // Sets a slot's position.
+        void setPosition(std::size_t slot, glm::vec3 position);
+
+        // Sets a slot's scale.
+        void setScale(std::size_t slot, glm::vec3 scale);
+
+        // Sets the local-space bounds of a slot's own content.
+        void setLocalBounds(std::size_t slot, const Aabb &bounds);
+
+        // Enables or disables Node::onWorldTransformChanged callbacks for the
+        // node owning a slot.
+        void setListener(std::size_t slot, bool listener);
+
+        // Rebuilds local and world transforms of dirty slots and their
+        // descendants across the whole store. World and subtree bounds of
+        // every slot on the way are recomputed bottom-up afterwards.
+        void updateWorldTransforms();
+
+        // Rebuilds local and world transforms of dirty slots within the
+        // subtree of a node. Subtree bounds of the node's ancestors are
+        // refreshed as well.
+        void updateWorldTransforms(const Node *root);
+
+        // Same as above, but splits the subtree into tasks of at least
+        // grainSize slots that run on a thread pool. Every slot goes through
+        // the same arithmetic as in the serial sweep, so the results are
+        // bit-identical. Node::onWorldTransformChanged callbacks may run on
+        // worker threads.
+        void updateWorldTransforms(
+            const Node *root,
+            ThreadPool &pool,
+            std::size_t grainSize = DEFAULT_GRAIN_SIZE);
+
+        // Starts a new step for previousWorldTransforms, which from here on
+        // holds the world transforms as they are now. Called before each
+        // simulation step so the state the step started from can be blended
+        // with the state it ended in. Slots are only copied when a sweep
+        // rebuilds them, so this costs as much as the slots rebuilt during
+        // the last step.
+        void savePreviousWorldTransforms();
+
+        // Rebuilds the local transform of a single slot from its position,
+        // orientation and scale.
+        void updateLocalTransform(std::size_t slot);
+
+        // Sets a slot's rotation from euler angles.
+        void setRotation(std::size_t slot, glm::vec3 rotation);
+
+        // Sets a slot's rotation from a quaternion.
+        void setOrientation(std::size_t slot, glm::quat orientation);
+
+        // Returns a slot's rotation as euler angles, deriving them from the
+        // quaternion when it was set directly.
+        glm::vec3 getRotation(std::size_t slot) const;
+
+        // Returns the number of allocated slots, including released ones that
+        // have not been compacted yet.
+        std::size_t size() const;
+    private:
+        // Whether a slot's previous world transform has to be caught up.
+        enum PreviousState : std::uint8_t {
+            // Previous and current world transforms are the same.
+            PREVIOUS_CURRENT,
+
+            // The slot was rebuilt since the last save, and its previous
+            // transform holds the one from before.
+            PREVIOUS_SAVED,
+
+            // Same as above, and the slot is in changedSlots.
+            PREVIOUS_LISTED,
+
+            // The slot was never built. Its first world transform is taken
+            // as its previous one too, so it doesn't blend in from the
+            // origin.
+            PREVIOUS_NEW,
+        };
+
+        // Set for slots whose owner wants transform change callbacks.
+        std::vector<std::uint8_t> listeners;
+
+        // State of each slot's previous world transform.
+        std::vector<std::uint8_t> previousStates;
+
+        // Slots rebuilt since the last save, gathered while bounds are
+        // updated, which happens on a single thread even for parallel
+        // updates.
+        std::vector<std::size_t> changedSlots;
+
+        // Scratch flags marking slots that were rebuilt during a sweep so
+        // their children know to rebuild as well.
+        std::vector<std::uint8_t> updated;
+
+        // Scratch flags marking every slot visited by a sweep. Only these
+        // can have subtree bounds that changed.
+        std::vector<std::uint8_t> boundsStale;
+
+        // Scratch list of stale slots in depth-first order.
+        std::vector<std::size_t> boundsOrder;
+
+        // Set when slots have been reparented or released and the depth-first
+        // layout must be rebuilt before the next sweep.
+        bool layoutDirty = false;
+
+        // Sorts slots into depth-first order, drops released slots and
+        // recomputes subtree sizes.
+        void rebuildLayout();
+
+        // Updates the slots in [begin, end), which must be a whole subtree or
+        // a run of sibling subtrees. Parents at or after boundary are treated
+        // as part of the current update and must already be processed, while
+        // parents before it are treated as clean.
+        void sweep(std::size_t begin, std::size_t end, std::size_t boundary);
+
+        // Returns whether a slot or anything below it has to be visited by a
+        // sweep, which is the case when it's dirty, has dirty descendants or
+        // its parent was rebuilt.
+        bool needsVisit(std::size_t slot, std::size_t boundary) const;
+
+        // Rebuilds a single slot if it or its parent changed. Callers must go
+        // on to visit the slot's children.
+        void updateSlot(std::size_t slot, std::size_t boundary);
+
+        // Recomputes bounds of the stale slots in [begin, end), children
+        // before parents, then refreshes the ancestors of begin when it's
+        // the root of a subtree update.
+        void updateBounds(std::size_t begin, std::size_t end);
+
+        // Recomputes the world and subtree bounds of a single slot from its
+        // local bounds and the subtree bounds of its children.
+        void updateSlotBounds(std::size_t slot);
+
+        // Updates a subtree for the parallel path, submitting large child
+        // subtrees and runs of small sibling subtrees as separate tasks.
+        void sweepParallel(
+            std::size_t root,
+            std::size_t boundary,
+            ThreadPool &pool,
+            TaskGroup &group,
+            std::size_t grainSize);
+    };
+}
@@ -0,0 +1,227 @@
+#include "profiling/profiler.hpp"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+
+namespace scenegraphdemo {
+    constexpr std::uint32_t Profiler::GPU_THREAD;
+    constexpr std::size_t Profiler::STATS_WINDOW;
+
+    std::atomic<bool> Profiler::enabled{false};
+
+    // Returns microseconds on a monotonic clock.
+    static std::int64_t clockMicroseconds() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Writes a string as a JSON string literal.
+    static void writeJsonString(std::ofstream &out, const char *value) {
+        out << '"';
+        for (; *value != '\0'; value++) {
+            if (*value == '"' || *value == '\\') {
+                out << '\\';
+            }
+            out << *value;
+        }
+        out << '"';
+    }
+
+    Profiler::Profiler() {
+        this->origin = clockMicroseconds();
+    }
+
+    Profiler &Profiler::get() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    void Profiler::setEnabled(bool enabled) {
+        Profiler::enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    std::int64_t Profiler::now() const {
+        return clockMicroseconds() - this->origin;
+    }
+
+    void Profiler::record(const char *name, std::int64_t begin, std::int64_t end) {
+        ThreadBuffer &buffer = this->getThreadBuffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        buffer.events.push_back(ProfileEvent{name, begin, end - begin, buffer.thread});
+    }
+
+    bool Profiler::beginGpu(const char *name) {
+        if (this->gpuActive) {
+            return false;
+        }
+
+        GpuQuery query;
+        if (this->freeQueries.empty()) {
+            glGenQueries(1, &query.query);
+        } else {
+            query.query = this->freeQueries.back();
+            this->freeQueries.pop_back();
+        }
+        query.name = name;
+        query.begin = this->now();
+        glBeginQuery(GL_TIME_ELAPSED, query.query);
+        this->pendingQueries.push_back(query);
+        this->gpuActive = true;
+        return true;
+    }
+
+    void Profiler::endGpu() {
+        glEndQuery(GL_TIME_ELAPSED);
+        this->gpuActive = false;
+    }
+
+    void Profiler::endFrame() {
+        {
+            std::lock_guard<std::mutex> lock(this->buffersMutex);
+            for (auto &buffer : this->buffers) {
+                std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+                this->collected.insert(this->collected.end(), buffer->events.begin(), buffer->events.end());
+                buffer->events.clear();
+            }
+
+            // Buffers only referenced here belong to threads that exited.
+            this->buffers.erase(std::remove_if(this->buffers.begin(), this->buffers.end(),
+                [](const std::shared_ptr<ThreadBuffer> &buffer) {
+                    return buffer.use_count() == 1;
+                }), this->buffers.end());
+        }
+        for (const auto &event : this->collected) {
+            this->consume(event, false);
+        }
+        this->collected.clear();
+
+        // Queries finish in the order they were issued, so stop at the first
+        // one whose result isn't in yet. Those are read on a later frame.
+        while (!this->pendingQueries.empty()) {
+            const GpuQuery &query = this->pendingQueries.front();
+            if (this->gpuActive && this->pendingQueries.size() == 1) {
+                break;
+            }
+            GLint available = 0;
+            glGetQueryObjectiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                break;
+            }
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &nanoseconds);
+            this->consume(ProfileEvent{query.name, query.begin,
+                static_cast<std::int64_t>(nanoseconds / 1000), GPU_THREAD}, true);
+            this->freeQueries.push_back(query.query);
+            this->pendingQueries.pop_front();
+        }
+
+        for (auto &entry : this->phases) {
+            Phase &phase = entry.second;
+            if (!phase.seen) {
+                continue;
+            }
+            phase.frames.push_back(phase.current);
+            if (phase.frames.size() > STATS_WINDOW) {
+                phase.frames.pop_front();
+            }
+            phase.current = 0.0;
+            phase.seen = false;
+        }
+    }
+
+    void Profiler::startCapture(std::size_t maxEvents) {
+        this->capture.clear();
+        this->maxCaptureEvents = maxEvents;
+        this->capturing = true;
+    }
+
+    void Profiler::writeCapture(const std::string &filename) {
+        this->capturing = false;
+
+        std::ofstream out(filename, std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot write profile capture: " + filename);
+        }
+        out << "{\"traceEvents\":[\n";
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_THREAD
+            << ",\"args\":{\"name\":\"GPU\"}}";
+        for (const auto &event : this->capture) {
+            out << ",\n{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"cat\":\"" << (event.thread == GPU_THREAD ? "gpu" : "cpu")
+                << "\",\"ph\":\"X\",\"ts\":" << event.begin << ",\"dur\":" << event.duration
+                << ",\"pid\":1,\"tid\":" << event.thread << "}";
+        }
+        out << "\n]}\n";
+        this->capture.clear();
+        if (!out) {
+            throw std::runtime_error("Cannot write profile capture: " + filename);
+        }
+    }
+
+    std::vector<ProfileStats> Profiler::getStats() const {
+        std::vector<ProfileStats> stats;
+        for (const auto &entry : this->phases) {
+            const Phase &phase = entry.second;
+            if (phase.frames.empty()) {
+                continue;
+            }
+            ProfileStats phaseStats;
+            phaseStats.name = entry.first;
+            phaseStats.gpu = phase.gpu;
+            phaseStats.minimum = *std::min_element(phase.frames.begin(), phase.frames.end());
+            phaseStats.maximum = *std::max_element(phase.frames.begin(), phase.frames.end());
+            phaseStats.last = phase.frames.back();
+            phaseStats.frames = phase.frames.size();
+            for (double frame : phase.frames) {
+                phaseStats.average += frame;
+            }
+            phaseStats.average /= phase.frames.size();
+            stats.push_back(phaseStats);
+        }
+        std::sort(stats.begin(), stats.end(), [](const ProfileStats &a, const ProfileStats &b) {
+            return a.gpu != b.gpu ? b.gpu : a.name < b.name;
+        });
+        return stats;
+    }
+
+    void Profiler::releaseGpu() {
+        for (const auto &query : this->pendingQueries) {
+            this->freeQueries.push_back(query.query);
+        }
+        this->pendingQueries.clear();
+        if (!this->freeQueries.empty()) {
+            glDeleteQueries(this->freeQueries.size(), this->freeQueries.data());
+        }
+        this->freeQueries.clear();
+        this->gpuActive = false;
+    }
+
+    Profiler::ThreadBuffer &Profiler::getThreadBuffer() {
+        // The profiler keeps a reference too, so events recorded just before
+        // a thread exits are still collected.
+        thread_local std::shared_ptr<ThreadBuffer> buffer;
+        if (!buffer) {
+            buffer = std::make_shared<ThreadBuffer>();
+            std::lock_guard<std::mutex> lock(this->buffersMutex);
+            buffer->thread = this->nextThread++;
+            this->buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    void Profiler::consume(const ProfileEvent &event, bool gpu) {
+        // GPU phases get their own entries so they can share names with the
+        // CPU work that issued them.
+        Phase &phase = this->phases[gpu ? std::string("gpu:") + event.name : std::string(event.name)];
+        phase.gpu = gpu;
+        phase.current += event.duration / 1000.0;
+        phase.seen = true;
+
+        if (this->capturing && this->capture.size() < this->maxCaptureEvents) {
+            this->capture.push_back(event);
+        }
+    }
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Whether profiling scopes are compiled in. Without it ProfileScope and
+// GpuProfileScope are empty and cost nothing at all.
+#ifndef SCENEGRAPHDEMO_PROFILING
+#define SCENEGRAPHDEMO_PROFILING 1
+#endif
+
+namespace scenegraphdemo {
+    // Timed span of work on one thread, or on the GPU. Names must outlive the
+    // profiler, which in practice means string literals.
+    struct ProfileEvent {
+        const char *name;
+
+        // Microseconds since the profiler started.
+        std::int64_t begin;
+        std::int64_t duration;
+
+        // Profiler-assigned id of the thread, or GPU_THREAD for GPU work.
+        std::uint32_t thread;
+    };
+
+    // Rolling statistics of one named phase, over the time it took in each of
+    // the frames it ran in.
+    struct ProfileStats {
+        std::string name;
+        bool gpu = false;
+
+        // Milliseconds per frame over the frames in the window.
+        double average = 0.0;
+        double minimum = 0.0;
+        double maximum = 0.0;
+        double last = 0.0;
+
+        // Number of frames in the window.
+        std::size_t frames = 0;
+    };
+
+    // Collects scoped CPU timings from any thread and GPU timings from the
+    // OpenGL thread, keeps rolling statistics per phase and records Chrome
+    // trace-event captures. Each thread writes its events into a buffer of
+    // its own, which the OpenGL thread collects once per frame. GPU timer
+    // queries are read back a few frames later, once their results are in,
+    // so measuring never stalls the pipeline.
+    class Profiler {
+    public:
+        // Thread id used for GPU events.
+        static constexpr std::uint32_t GPU_THREAD = 0;
+
+        // Number of frames the rolling statistics cover.
+        static constexpr std::size_t STATS_WINDOW = 120;
+
+        // Returns the profiler shared by the whole program.
+        static Profiler &get();
+
+        // Turns collection on or off. Scopes do nothing while it's off apart
+        // from checking the flag. Off by default.
+        static void setEnabled(bool enabled);
+        static bool isEnabled() {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        // Returns microseconds since the profiler started.
+        std::int64_t now() const;
+
+        // Records a finished CPU event on the calling thread.
+        void record(const char *name, std::int64_t begin, std::int64_t end);
+
+        // Starts a GL_TIME_ELAPSED query and returns true, or returns false
+        // if one is already running, since OpenGL only allows one at a time.
+        // endGpu must only be called after beginGpu returned true. Must be
+        // called on the OpenGL thread.
+        bool beginGpu(const char *name);
+        void endGpu();
+
+        // Marks the end of a frame. Collects the events of every thread,
+        // reads back finished GPU queries and updates the statistics. Must be
+        // called on the OpenGL thread.
+        void endFrame();
+
+        // Starts keeping every event for a trace capture. Captures stop
+        // recording past maxEvents events.
+        void startCapture(std::size_t maxEvents = 1000000);
+
+        // Writes the captured events as Chrome trace-event JSON, which can be
+        // loaded in chrome://tracing or Perfetto, and stops capturing. Throws a
+        // std::runtime_error if the file can't be written.
+        void writeCapture(const std::string &filename);
+
+        // Returns the rolling statistics of every phase seen so far.
+        std::vector<ProfileStats> getStats() const;
+
+        // Releases the GPU queries. Must be called on the OpenGL thread
+        // before the context goes away.
+        void releaseGpu();
+    private:
+        // Events of one thread, guarded by its own mutex so recording only
+        // contends with the once-per-frame collection.
+        struct ThreadBuffer {
+            std::uint32_t thread;
+            std::mutex mutex;
+            std::vector<ProfileEvent> events;
+        };
+
+        // Timer query in flight.
+        struct GpuQuery {
+            unsigned int query;
+            const char *name;
+            std::int64_t begin;
+        };
+
+        // Per-frame totals of one phase.
+        struct Phase {
+            bool gpu;
+            std::deque<double> frames;
+            double current = 0.0;
+            bool seen = false;
+        };
+
+        static std::atomic<bool> enabled;
+
+        std::int64_t origin;
+
+        std::mutex buffersMutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        std::uint32_t nextThread = GPU_THREAD + 1;
+
+        // Events moved out of the thread buffers, reused between frames.
+        std::vector<ProfileEvent> collected;
+
+        std::vector<unsigned int> freeQueries;
+        std::deque<GpuQuery> pendingQueries;
+        bool gpuActive = false;
+
+        std::unordered_map<std::string, Phase> phases;
+
+        bool capturing = false;
+        std::size_t maxCaptureEvents = 0;
+        std::vector<ProfileEvent> capture;
+
+        Profiler();
+
+        // Returns the calling thread's buffer, registering it on first use.
+        ThreadBuffer &getThreadBuffer();
+
+        // Adds an event to the current frame's statistics and the capture.
+        void consume(const ProfileEvent &event, bool gpu);
+    };
+
+    // Times the enclosing scope on the calling thread.
+    class ProfileScope {
+    public:
+#if SCENEGRAPHDEMO_PROFILING
+        ProfileScope(const char *name) : name(name) {
+            if (Profiler::isEnabled()) {
+                begin = Profiler::get().now();
+            }
+        }
+
+        ~ProfileScope() {
+            if (begin >= 0 && Profiler::isEnabled()) {
+                Profiler &profiler = Profiler::get();
+                profiler.record(name, begin, profiler.now());
+            }
+        }
+#else
+        ProfileScope(const char *) {
+        }
+#endif
+
+        ProfileScope(const ProfileScope &) = delete;
+        ProfileScope &operator=(const ProfileScope &) = delete;
+#if SCENEGRAPHDEMO_PROFILING
+    private:
+        const char *name;
+        std::int64_t begin = -1;
+#endif
+    };
+
+    // Times the GPU work issued in the enclosing scope. Must not be nested.
+    class GpuProfileScope {
+    public:
+#if SCENEGRAPHDEMO_PROFILING
+        GpuProfileScope(const char *name) {
+            if (Profiler::isEnabled()) {
+                active = Profiler::get().beginGpu(name);
+            }
+        }
+
+        ~GpuProfileScope() {
+            if (active) {
+                Profiler::get().endGpu();
+            }
+        }
+#else
+        GpuProfileScope(const char *) {
+        }
+#endif
+
+        GpuProfileScope(const GpuProfileScope &) = delete;
+        GpuProfileScope &operator=(const GpuProfileScope &) = delete;
+#if SCENEGRAPHDEMO_PROFILING
+    private:
+        bool active = false;
+#endif
+    };
+}
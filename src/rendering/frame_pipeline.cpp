@@ -0,0 +1,147 @@
+#include "profiling/profiler.hpp"
+#include "rendering/frame_pipeline.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace scenegraphdemo {
+    // Returns the length of a duration in milliseconds.
+    static double milliseconds(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    FramePipeline::FramePipeline(Simulation simulation, bool threaded) {
+        this->simulation = std::move(simulation);
+        if (threaded) {
+            this->thread = std::thread([this] {
+                this->run();
+            });
+        }
+    }
+
+    FramePipeline::~FramePipeline() {
+        if (this->thread.joinable()) {
+            this->stopping.store(true);
+            this->notify();
+            this->thread.join();
+        }
+    }
+
+    bool FramePipeline::isThreaded() const {
+        return this->thread.joinable();
+    }
+
+    const FrameSnapshot &FramePipeline::acquire() {
+        if (!this->thread.joinable()) {
+            this->simulate();
+        } else {
+            ProfileScope scope("wait");
+            const auto begin = std::chrono::steady_clock::now();
+            this->waitUntil([this] {
+                return this->failed.load() || this->produced.load() > this->consumed.load();
+            });
+            this->totalWait += milliseconds(std::chrono::steady_clock::now() - begin);
+            if (this->failed.load()) {
+                std::rethrow_exception(this->failure);
+            }
+        }
+
+        // The simulation can't publish again before the frame is marked as
+        // consumed, so this always takes the frame that was waited for.
+        this->snapshots.update();
+        const FrameSnapshot &snapshot = this->snapshots.getReadBuffer();
+        this->consumed.store(snapshot.frame);
+        this->notify();
+        return snapshot;
+    }
+
+    void FramePipeline::present() {
+        const auto now = std::chrono::steady_clock::now();
+        const FrameSnapshot &snapshot = this->snapshots.getReadBuffer();
+        const double latency = milliseconds(now - snapshot.simulationBegin);
+        if (this->frames == 0) {
+            this->firstPresent = now;
+        }
+        this->lastPresent = now;
+        this->frames++;
+        this->totalLatency += latency;
+        this->maximumLatency = std::max(this->maximumLatency, latency);
+        this->totalSimulation += milliseconds(snapshot.simulationEnd - snapshot.simulationBegin);
+    }
+
+    PipelineStats FramePipeline::getStats() const {
+        PipelineStats stats;
+        stats.frames = this->frames;
+        if (this->frames == 0) {
+            return stats;
+        }
+        const double elapsed = milliseconds(this->lastPresent - this->firstPresent);
+        if (elapsed > 0.0) {
+            stats.framesPerSecond = (this->frames - 1) * 1000.0 / elapsed;
+        }
+        stats.averageLatency = this->totalLatency / this->frames;
+        stats.maximumLatency = this->maximumLatency;
+        stats.averageSimulation = this->totalSimulation / this->frames;
+        stats.averageWait = this->totalWait / this->frames;
+        return stats;
+    }
+
+    void FramePipeline::simulate() {
+        FrameSnapshot &snapshot = this->snapshots.getWriteBuffer();
+        const std::uint64_t frame = this->produced.load(std::memory_order_relaxed) + 1;
+        snapshot.frame = frame;
+        snapshot.simulationBegin = std::chrono::steady_clock::now();
+        {
+            ProfileScope scope("simulate");
+            this->simulation(snapshot);
+        }
+        snapshot.simulationEnd = std::chrono::steady_clock::now();
+
+        // The snapshot belongs to the reader from here on.
+        this->snapshots.publish();
+        this->produced.store(frame);
+        this->notify();
+    }
+
+    void FramePipeline::run() {
+        while (true) {
+            // Stay at most one frame ahead of the frame being drawn.
+            this->waitUntil([this] {
+                return this->stopping.load() || this->produced.load() <= this->consumed.load();
+            });
+            if (this->stopping.load()) {
+                break;
+            }
+
+            try {
+                this->simulate();
+            } catch (...) {
+                this->failure = std::current_exception();
+                this->failed.store(true);
+                this->notify();
+                break;
+            }
+        }
+    }
+
+    template<typename Predicate>
+    void FramePipeline::waitUntil(Predicate ready) {
+        if (ready()) {
+            return;
+        }
+
+        // Registering as a sleeper before checking again means a waker either
+        // sees the sleeper and takes the mutex to notify it, or stored its
+        // change before the check and the sleep is skipped.
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->sleepers.fetch_add(1);
+        this->wake.wait(lock, ready);
+        this->sleepers.fetch_sub(1);
+    }
+
+    void FramePipeline::notify() {
+        if (this->sleepers.load() != 0) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->wake.notify_all();
+        }
+    }
+}
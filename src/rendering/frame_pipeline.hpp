@@ -0,0 +1,118 @@
+#pragma once
+
+#include "rendering/frame_snapshot.hpp"
+#include "threading/triple_buffer.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace scenegraphdemo {
+    // Throughput and latency of the frames drawn so far.
+    struct PipelineStats {
+        // Number of frames presented.
+        std::size_t frames = 0;
+
+        // Frames presented per second, from the first to the last one.
+        double framesPerSecond = 0.0;
+
+        // Milliseconds from the start of a frame's simulation to its
+        // presentation.
+        double averageLatency = 0.0;
+        double maximumLatency = 0.0;
+
+        // Milliseconds spent simulating a frame.
+        double averageSimulation = 0.0;
+
+        // Milliseconds the drawing thread spent waiting for a snapshot.
+        double averageWait = 0.0;
+    };
+
+    // Produces the snapshots the OpenGL thread draws from. Serial pipelines
+    // simulate each frame on the OpenGL thread right before it's drawn.
+    // Threaded pipelines simulate on a thread of their own, one frame ahead,
+    // so frame N+1 is simulated while frame N is drawn. Snapshots are handed
+    // over through a triple buffer, so neither thread ever locks to pass a
+    // frame. The threads only sleep, on a condition variable, when one of
+    // them got a full frame ahead of the other.
+    class FramePipeline {
+    public:
+        // Fills a snapshot for the next frame. While a threaded pipeline is
+        // running it's the only code allowed to touch the scenegraph.
+        typedef std::function<void(FrameSnapshot &snapshot)> Simulation;
+
+        // Starts the simulation thread right away if threaded is set.
+        FramePipeline(Simulation simulation, bool threaded);
+
+        // Stops the simulation thread, after which the scenegraph belongs to
+        // the calling thread again.
+        ~FramePipeline();
+
+        FramePipeline(const FramePipeline &) = delete;
+        FramePipeline &operator=(const FramePipeline &) = delete;
+
+        bool isThreaded() const;
+
+        // Returns the snapshot of the next frame, which stays valid until the
+        // next call. Threaded pipelines wait for the simulation thread if it
+        // hasn't finished the frame yet, and let it start on the one after.
+        // Exceptions thrown by the simulation are rethrown here.
+        const FrameSnapshot &acquire();
+
+        // Records that the last acquired snapshot was presented.
+        void present();
+
+        // Returns the throughput and latency of the frames presented so far.
+        PipelineStats getStats() const;
+    private:
+        Simulation simulation;
+        TripleBuffer<FrameSnapshot> snapshots;
+
+        // Number of frames published by the simulation and taken by the
+        // drawing thread.
+        std::atomic<std::uint64_t> produced{0};
+        std::atomic<std::uint64_t> consumed{0};
+
+        // Set by the simulation thread, after storing the exception, if the
+        // simulation threw.
+        std::atomic<bool> failed{false};
+        std::exception_ptr failure;
+
+        std::atomic<bool> stopping{false};
+
+        // Only used by threads that have to sleep. Wakers skip the mutex
+        // unless someone is sleeping.
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::atomic<std::size_t> sleepers{0};
+
+        std::thread thread;
+
+        // Statistics, only touched by the drawing thread.
+        std::size_t frames = 0;
+        std::chrono::steady_clock::time_point firstPresent;
+        std::chrono::steady_clock::time_point lastPresent;
+        double totalLatency = 0.0;
+        double maximumLatency = 0.0;
+        double totalSimulation = 0.0;
+        double totalWait = 0.0;
+
+        // Runs the simulation into the write buffer and publishes it.
+        void simulate();
+
+        // Main loop of the simulation thread.
+        void run();
+
+        // Blocks until ready returns true.
+        template<typename Predicate>
+        void waitUntil(Predicate ready);
+
+        // Wakes the other thread if it's sleeping.
+        void notify();
+    };
+}
@@ -0,0 +1,40 @@
+#include "math/transform_kernels.hpp"
+#include "nodes/node.hpp"
+#include "nodes/perspective_camera.hpp"
+#include "rendering/frame_snapshot.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace scenegraphdemo {
+    void FrameSnapshot::capture(Node *root, const PerspectiveCamera &camera, float alpha) {
+        // The camera looks down the negative z axis of its world transform.
+        const glm::mat4 cameraTransform = alpha < 1.0f ?
+            interpolateTransform(camera.getPreviousWorldTransform(), camera.getWorldTransform(), alpha) :
+            camera.getWorldTransform();
+        const glm::vec3 eye = glm::vec3(cameraTransform[3]);
+        const glm::vec3 forward = -glm::normalize(glm::vec3(cameraTransform[2]));
+
+        if (alpha < 1.0f) {
+            const glm::vec3 up = glm::normalize(glm::vec3(cameraTransform[1]));
+            this->viewProjectionMatrix = camera.projectionMatrix * glm::lookAt(eye, eye + forward, up);
+        } else {
+            this->viewProjectionMatrix = camera.viewProjectionMatrix;
+        }
+
+        // Cull with the camera the frame is drawn with, so nothing pops in or
+        // out at the edges of the view while the camera turns.
+        this->items.clear();
+        this->culler.cull(root, Frustum(this->viewProjectionMatrix), this->visibleNodes);
+        this->cullStats = this->culler.getStats();
+        for (auto node : this->visibleNodes) {
+            if (node->renderable == nullptr) {
+                continue;
+            }
+            const glm::mat4 worldTransform = alpha < 1.0f ?
+                interpolateTransform(node->getPreviousWorldTransform(), node->getWorldTransform(), alpha) :
+                node->getWorldTransform();
+            const float depth = glm::dot(glm::vec3(worldTransform[3]) - eye, forward);
+            this->items.push_back(SnapshotItem{node->renderable, worldTransform, depth});
+        }
+    }
+}
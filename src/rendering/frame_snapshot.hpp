@@ -0,0 +1,52 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "nodes/frustum_culler.hpp"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace scenegraphdemo {
+    class Node;
+    class PerspectiveCamera;
+    struct Renderable;
+
+    // Visible renderable and where to draw it.
+    struct SnapshotItem {
+        const Renderable *renderable;
+        glm::mat4 worldTransform;
+
+        // Distance along the camera's view direction.
+        float depth;
+    };
+
+    // Everything needed to draw one frame, copied out of the scenegraph so it
+    // can be drawn while the scenegraph is already being updated for the next
+    // frame. Renderables are only pointed to, so they must only be changed on
+    // the thread that draws.
+    struct FrameSnapshot {
+        // Number of the frame, counting from 1.
+        std::uint64_t frame = 0;
+
+        // When the simulation of the frame started and finished.
+        std::chrono::steady_clock::time_point simulationBegin;
+        std::chrono::steady_clock::time_point simulationEnd;
+
+        glm::mat4 viewProjectionMatrix;
+        std::vector<SnapshotItem> items;
+
+        // Counters of the cull the items came from.
+        CullStats cullStats;
+
+        // Replaces the items with the visible nodes below root that have a
+        // renderable, as seen by the camera. World transforms must be updated
+        // beforehand. Transforms and the camera are blended from the previous
+        // world transforms of the nodes by alpha, from 0 for the previous
+        // ones to 1 for the current ones. Culling uses the blended camera but
+        // the current bounds of the nodes.
+        void capture(Node *root, const PerspectiveCamera &camera, float alpha = 1.0f);
+    private:
+        FrustumCuller culler;
+        std::vector<Node *> visibleNodes;
+    };
+}
@@ -0,0 +1,322 @@
+#include "math/transform_kernels.hpp"
+#include "rendering/frame_snapshot.hpp"
+#include "rendering/render_queue.hpp"
+#include "resources/image_resource.hpp"
+#include "resources/texture_array.hpp"
+#include "shaders/shader.hpp"
+#include <GL/glew.h>
+#include <climits>
+#include <cstring>
+#include <glm/glm.hpp>
+
+namespace scenegraphdemo {
+    // First attribute location of the per-instance mat4, which takes up four
+    // consecutive vec4 locations.
+    const unsigned int INSTANCE_TRANSFORM_LOCATION = 2;
+
+    // Attribute location of the per-instance texture array layer.
+    const unsigned int INSTANCE_LAYER_LOCATION = 6;
+
+    // Widths of the sort key fields, from most to least significant. Ids wider
+    // than their field are truncated, which can only interleave items with
+    // different state and cost extra state changes, never draw them wrong.
+    const unsigned int KEY_PROGRAM_BITS = 12;
+    const unsigned int KEY_TEXTURE_BITS = 16;
+    const unsigned int KEY_VERTEX_ARRAY_BITS = 16;
+    const unsigned int KEY_DEPTH_BITS = 20;
+
+    // Stand-in for state that hasn't been set yet during a flush.
+    const unsigned int UNKNOWN_STATE = UINT_MAX;
+
+    static std::uint64_t keyField(std::uint64_t value, unsigned int bits) {
+        return value & ((std::uint64_t(1) << bits) - 1);
+    }
+
+    // Returns the size in bytes of an OpenGL index type.
+    static std::size_t indexSize(unsigned int indexType) {
+        switch (indexType) {
+        case GL_UNSIGNED_BYTE:
+            return 1;
+        case GL_UNSIGNED_SHORT:
+            return 2;
+        default:
+            return 4;
+        }
+    }
+
+    RenderQueue::RenderQueue() {
+        // Base instances are needed to find each command's instance data.
+        this->indirectSupported = GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance;
+        this->indirect = this->indirectSupported;
+    }
+
+    void RenderQueue::submit(const Renderable &renderable, const glm::mat4 &worldTransform, float depth) {
+        if (renderable.shader == nullptr) {
+            return;
+        }
+        this->items.push_back(DrawItem{makeKey(renderable, depth), &renderable, worldTransform});
+    }
+
+    void RenderQueue::submit(const FrameSnapshot &snapshot) {
+        for (const auto &item : snapshot.items) {
+            submit(*item.renderable, item.worldTransform, item.depth);
+        }
+    }
+
+    void RenderQueue::flush(const glm::mat4 &viewProjectionMatrix) {
+        stats = RenderStats();
+        stats.items = items.size();
+        if (items.empty()) {
+            return;
+        }
+
+        sort();
+        buildCommands();
+
+        // Write the model view projection matrices, layers and, for indirect
+        // draws, the commands straight into the stream buffer, in a single
+        // pass over each, so every run of instances is a contiguous range of
+        // it.
+        const std::size_t count = order.size();
+        const bool drawIndirect = isIndirect();
+        const std::size_t transformBytes = count * sizeof(glm::mat4);
+        const std::size_t layerBytes = count * sizeof(float);
+        const std::size_t commandBytes = drawIndirect ? commands.size() * sizeof(DrawCommand) : 0;
+        char *memory = static_cast<char *>(instanceStream.map(transformBytes + layerBytes + commandBytes));
+        float *instanceLayers = reinterpret_cast<float *>(memory + transformBytes);
+        sortedTransforms.resize(count);
+        const Renderable *previous = nullptr;
+        for (std::size_t i = 0; i < count; i++) {
+            const DrawItem &item = items[order[i].index];
+            sortedTransforms[i] = item.worldTransform;
+            instanceLayers[i] = item.renderable->textureLayer;
+
+            // Separate textures would have needed a bind here.
+            if (previous != nullptr && item.renderable->textureArray != nullptr &&
+                    item.renderable->textureArray == previous->textureArray &&
+                    item.renderable->textureLayer != previous->textureLayer) {
+                stats.avoidedTextureBinds++;
+            }
+            previous = item.renderable;
+        }
+        multiplyTransforms(viewProjectionMatrix, sortedTransforms.data(),
+            reinterpret_cast<glm::mat4 *>(memory), count);
+        if (drawIndirect) {
+            std::memcpy(memory + transformBytes + layerBytes, commands.data(), commandBytes);
+        }
+        instanceStream.unmap();
+        const std::size_t transformOffset = instanceStream.getOffset();
+        const std::size_t layerOffset = transformOffset + transformBytes;
+        const std::size_t commandOffset = layerOffset + layerBytes;
+
+        // Other code may have changed state since the last flush.
+        unsigned int currentProgram = UNKNOWN_STATE;
+        unsigned int currentTexture = UNKNOWN_STATE;
+        unsigned int currentVertexArray = UNKNOWN_STATE;
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceStream.getBuffer());
+        if (drawIndirect) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, instanceStream.getBuffer());
+        }
+        for (const auto &batch : batches) {
+            const DrawCommand &first = commands[batch.firstCommand];
+            const Renderable &renderable = *items[order[first.baseInstance].index].renderable;
+            const unsigned int program = renderable.shader->getProgram();
+            if (program != currentProgram) {
+                renderable.shader->use();
+                currentProgram = program;
+                stats.programSwitches++;
+            }
+            if (batch.texture != currentTexture) {
+                if (renderable.textureArray != nullptr) {
+                    renderable.textureArray->bind();
+                } else {
+                    renderable.texture->bind();
+                }
+                currentTexture = batch.texture;
+                stats.textureBinds++;
+            }
+            if (renderable.vertexArray != currentVertexArray) {
+                glBindVertexArray(renderable.vertexArray);
+                currentVertexArray = renderable.vertexArray;
+                stats.vertexArrayBinds++;
+            }
+            stats.runs += batch.commandCount;
+
+            if (drawIndirect) {
+                // Instanced attributes are fetched at the command's base
+                // instance, which is where its run starts, so the attributes
+                // point at the start of the frame's data and every run of the
+                // batch goes out in a single call.
+                setInstanceAttributes(transformOffset, layerOffset);
+                const auto indirectOffset = reinterpret_cast<void *>(
+                    commandOffset + batch.firstCommand * sizeof(DrawCommand));
+                if (batch.indexType != 0) {
+                    glMultiDrawElementsIndirect(GL_TRIANGLES, batch.indexType, indirectOffset,
+                        batch.commandCount, sizeof(DrawCommand));
+                } else {
+                    glMultiDrawArraysIndirect(GL_TRIANGLES, indirectOffset, batch.commandCount,
+                        sizeof(DrawCommand));
+                }
+                stats.drawCalls++;
+                continue;
+            }
+
+            // Point the instance attributes at each run's range of the buffer
+            // and draw it on its own.
+            for (std::size_t i = 0; i < batch.commandCount; i++) {
+                const DrawCommand &command = commands[batch.firstCommand + i];
+                setInstanceAttributes(transformOffset + command.baseInstance * sizeof(glm::mat4),
+                    layerOffset + command.baseInstance * sizeof(float));
+                if (batch.indexType != 0) {
+                    glDrawElementsInstanced(GL_TRIANGLES, command.count, batch.indexType,
+                        reinterpret_cast<void *>(command.first * indexSize(batch.indexType)),
+                        command.instanceCount);
+                } else {
+                    glDrawArraysInstanced(GL_TRIANGLES, command.first, command.count, command.instanceCount);
+                }
+                stats.drawCalls++;
+            }
+        }
+        if (drawIndirect) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        glBindVertexArray(0);
+        instanceStream.fence();
+
+        items.clear();
+    }
+
+    void RenderQueue::setIndirect(bool indirect) {
+        this->indirect = indirect;
+    }
+
+    bool RenderQueue::isIndirect() const {
+        return this->indirect && this->indirectSupported;
+    }
+
+    const RenderStats &RenderQueue::getStats() const {
+        return stats;
+    }
+
+    const StreamBufferStats &RenderQueue::getStreamStats() const {
+        return instanceStream.getStats();
+    }
+
+    unsigned int RenderQueue::textureOf(const Renderable &renderable) {
+        if (renderable.textureArray != nullptr) {
+            return renderable.textureArray->getTexture();
+        } else if (renderable.texture != nullptr) {
+            return renderable.texture->getTexture();
+        } else {
+            return 0;
+        }
+    }
+
+    std::uint64_t RenderQueue::makeKey(const Renderable &renderable, float depth) {
+        // The bit pattern of a non-negative float grows with its value, so its
+        // top bits quantize depth without knowing the clip range. Items behind
+        // the camera or with an invalid depth sort first.
+        std::uint32_t depthBits = 0;
+        if (depth > 0.0f) {
+            std::memcpy(&depthBits, &depth, sizeof(depthBits));
+            depthBits >>= 31 - KEY_DEPTH_BITS;
+        }
+
+        const unsigned int texture = textureOf(renderable);
+        std::uint64_t key = keyField(renderable.shader->getProgram(), KEY_PROGRAM_BITS);
+        key = key << KEY_TEXTURE_BITS | keyField(texture, KEY_TEXTURE_BITS);
+        key = key << KEY_VERTEX_ARRAY_BITS | keyField(renderable.vertexArray, KEY_VERTEX_ARRAY_BITS);
+        key = key << KEY_DEPTH_BITS | keyField(depthBits, KEY_DEPTH_BITS);
+        return key;
+    }
+
+    void RenderQueue::buildCommands() {
+        commands.clear();
+        batches.clear();
+
+        // Items sharing a shader, texture, vertex array and index type form a
+        // batch, and items within it that also share a vertex or index range
+        // form a run. Depth is the least significant key field, so runs are
+        // adjacent. Items without a texture keep whatever texture came before
+        // them.
+        unsigned int texture = UNKNOWN_STATE;
+        const Renderable *previous = nullptr;
+        for (std::size_t i = 0; i < order.size(); i++) {
+            const Renderable &renderable = *items[order[i].index].renderable;
+            const unsigned int itemTexture = textureOf(renderable) != 0 ? textureOf(renderable) : texture;
+            const bool sameBatch = previous != nullptr &&
+                renderable.shader->getProgram() == previous->shader->getProgram() &&
+                itemTexture == texture &&
+                renderable.vertexArray == previous->vertexArray &&
+                renderable.indexType == previous->indexType;
+            if (!sameBatch) {
+                texture = itemTexture;
+                batches.push_back(Batch{commands.size(), 0, texture, renderable.indexType});
+            }
+            if (sameBatch && renderable.firstVertex == previous->firstVertex &&
+                    renderable.vertexCount == previous->vertexCount) {
+                commands.back().instanceCount++;
+            } else {
+                const auto baseInstance = static_cast<std::uint32_t>(i);
+                commands.push_back(DrawCommand{static_cast<std::uint32_t>(renderable.vertexCount), 1,
+                    static_cast<std::uint32_t>(renderable.firstVertex),
+                    renderable.indexType != 0 ? 0 : baseInstance, baseInstance});
+                batches.back().commandCount++;
+            }
+            previous = &renderable;
+        }
+    }
+
+    void RenderQueue::setInstanceAttributes(std::size_t transformOffset, std::size_t layerOffset) {
+        // Each mat4 column is a separate vec4 attribute.
+        for (unsigned int column = 0; column < 4; column++) {
+            const auto location = INSTANCE_TRANSFORM_LOCATION + column;
+            const auto byteOffset = transformOffset + column * sizeof(glm::vec4);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                reinterpret_cast<void *>(byteOffset));
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        glVertexAttribPointer(INSTANCE_LAYER_LOCATION, 1, GL_FLOAT, GL_FALSE, sizeof(float),
+            reinterpret_cast<void *>(layerOffset));
+        glEnableVertexAttribArray(INSTANCE_LAYER_LOCATION);
+        glVertexAttribDivisor(INSTANCE_LAYER_LOCATION, 1);
+    }
+
+    void RenderQueue::sort() {
+        const std::size_t count = items.size();
+        order.resize(count);
+        sortScratch.resize(count);
+        for (std::size_t i = 0; i < count; i++) {
+            order[i] = SortEntry{items[i].key, static_cast<std::uint32_t>(i)};
+        }
+
+        // Count every digit up front. A digit shared by all items can't change
+        // the order, so its pass is skipped.
+        std::size_t histograms[8][256] = {};
+        for (const auto &entry : order) {
+            for (unsigned int digit = 0; digit < 8; digit++) {
+                histograms[digit][(entry.key >> (digit * 8)) & 0xff]++;
+            }
+        }
+
+        for (unsigned int digit = 0; digit < 8; digit++) {
+            std::size_t *histogram = histograms[digit];
+            if (histogram[(order[0].key >> (digit * 8)) & 0xff] == count) {
+                continue;
+            }
+
+            std::size_t offset = 0;
+            for (unsigned int bucket = 0; bucket < 256; bucket++) {
+                const std::size_t size = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += size;
+            }
+            for (const auto &entry : order) {
+                sortScratch[histogram[(entry.key >> (digit * 8)) & 0xff]++] = entry;
+            }
+            order.swap(sortScratch);
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "rendering/renderable.hpp"
+#include "rendering/stream_buffer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace scenegraphdemo {
+    struct FrameSnapshot;
+
+    // Counters describing the OpenGL work done by the last flush.
+    struct RenderStats {
+        // Number of draw items submitted.
+        std::size_t items = 0;
+
+        // Number of draw calls issued.
+        std::size_t drawCalls = 0;
+
+        // Number of runs of instances sharing all state and vertex range.
+        // Each is a draw call of its own, or a command of an indirect one.
+        std::size_t runs = 0;
+
+        // Number of times the shader program was switched.
+        std::size_t programSwitches = 0;
+
+        // Number of times a texture was bound.
+        std::size_t textureBinds = 0;
+
+        // Number of texture binds saved by texture arrays, counted as
+        // consecutive items drawn from different layers of the same array.
+        std::size_t avoidedTextureBinds = 0;
+
+        // Number of times a vertex array was bound.
+        std::size_t vertexArrayBinds = 0;
+    };
+
+    // Collects draw items for a frame, sorts them by a 64-bit key built from
+    // their shader program, texture, vertex array and depth, and draws them in
+    // that order. State is only changed when a key field differs from the
+    // previous item, and consecutive items sharing all state are drawn with a
+    // single instanced draw call. Where ARB_multi_draw_indirect and
+    // ARB_base_instance are available, every run sharing a shader, texture
+    // and vertex array is drawn by a single glMultiDrawArraysIndirect or
+    // glMultiDrawElementsIndirect call instead, whatever ranges the runs draw.
+    class RenderQueue {
+    public:
+        RenderQueue();
+
+        RenderQueue(const RenderQueue &) = delete;
+        RenderQueue &operator=(const RenderQueue &) = delete;
+
+        // Adds a draw item. Depth is the distance along the camera's view
+        // direction and orders items sharing the same state front to back.
+        void submit(const Renderable &renderable, const glm::mat4 &worldTransform, float depth);
+
+        // Submits every item of a snapshot.
+        void submit(const FrameSnapshot &snapshot);
+
+        // Sorts and draws every submitted item, then empties the queue.
+        void flush(const glm::mat4 &viewProjectionMatrix);
+
+        // Turns drawing with indirect commands on or off. It's on by default
+        // where it's supported, and stays off elsewhere.
+        void setIndirect(bool indirect);
+
+        // Returns whether flushes draw with indirect commands.
+        bool isIndirect() const;
+
+        // Returns the counters of the last flush.
+        const RenderStats &getStats() const;
+
+        // Returns the counters of the buffer instance data is streamed
+        // through, including how often the GPU held it up.
+        const StreamBufferStats &getStreamStats() const;
+    private:
+        struct DrawItem {
+            std::uint64_t key;
+            const Renderable *renderable;
+            glm::mat4 worldTransform;
+        };
+
+        // Run of instances, laid out like OpenGL's
+        // DrawElementsIndirectCommand. The base instance is the index of the
+        // run's first item in draw order. Commands of non-indexed runs are
+        // read as DrawArraysIndirectCommand, which ends at baseVertex, so it
+        // holds a copy of the base instance for them.
+        struct DrawCommand {
+            std::uint32_t count;
+            std::uint32_t instanceCount;
+            std::uint32_t first;
+            std::uint32_t baseVertex;
+            std::uint32_t baseInstance;
+        };
+
+        // Consecutive runs sharing a shader, texture, vertex array and index
+        // type.
+        struct Batch {
+            std::size_t firstCommand;
+            std::size_t commandCount;
+            unsigned int texture;
+            unsigned int indexType;
+        };
+
+        // Sort key paired with the index of its item. Only these are moved
+        // while sorting.
+        struct SortEntry {
+            std::uint64_t key;
+            std::uint32_t index;
+        };
+
+        std::vector<DrawItem> items;
+        std::vector<SortEntry> order;
+        std::vector<SortEntry> sortScratch;
+
+        // World matrices in sorted order.
+        std::vector<glm::mat4> sortedTransforms;
+
+        // Runs and batches of the items in sorted order.
+        std::vector<DrawCommand> commands;
+        std::vector<Batch> batches;
+
+        bool indirectSupported;
+        bool indirect;
+
+        // Buffer holding each frame's per-instance model view projection
+        // matrices, followed by their texture layers.
+        StreamBuffer instanceStream;
+
+        RenderStats stats;
+
+        // Returns the id of the texture or texture array a renderable draws
+        // with, or 0 if it has none.
+        static unsigned int textureOf(const Renderable &renderable);
+
+        // Builds the sort key of a renderable at a given depth.
+        static std::uint64_t makeKey(const Renderable &renderable, float depth);
+
+        // Splits the sorted items into batches and runs.
+        void buildCommands();
+
+        // Points the per-instance attributes of the bound vertex array at
+        // the given offsets of the stream buffer.
+        void setInstanceAttributes(std::size_t transformOffset, std::size_t layerOffset);
+
+        // Sorts order by key with an LSD radix sort over 8-bit digits,
+        // skipping digits that are identical for every item.
+        void sort();
+    };
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+namespace scenegraphdemo {
+    class ImageResource;
+    class Shader;
+    class TextureArray;
+
+    // Describes how a node is drawn. Renderables are usually shared between
+    // nodes, and nodes whose renderables use the same vertex array, shader and
+    // texture or texture array are drawn together with a single instanced
+    // draw call.
+    struct Renderable {
+        // OpenGL vertex array holding the mesh. Attribute locations 2 to 5
+        // are reserved for per-instance transforms and 6 for the per-instance
+        // texture layer.
+        unsigned int vertexArray = 0;
+
+        // Range of vertices drawn from the vertex array as triangles, or of
+        // indices for indexed meshes. Meshes sharing a vertex array can be
+        // drawn by a single indirect call.
+        int firstVertex = 0;
+        int vertexCount = 0;
+
+        // Type of the indices in the vertex array's element buffer, such as
+        // GL_UNSIGNED_SHORT, or 0 if the mesh isn't indexed.
+        unsigned int indexType = 0;
+
+        // Shader program used to draw the mesh. It receives each instance's
+        // model view projection matrix as a mat4 attribute at location 2.
+        Shader *shader = nullptr;
+
+        // Texture bound to unit 0 while drawing, if any.
+        ImageResource *texture = nullptr;
+
+        // Texture array bound to unit 0 in place of texture, if any, and the
+        // layer holding this renderable's image. Renderables sharing an array
+        // are drawn together even if their layers differ. The shader receives
+        // the layer as a float attribute at location 6.
+        TextureArray *textureArray = nullptr;
+        unsigned int textureLayer = 0;
+    };
+}
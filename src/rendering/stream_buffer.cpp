@@ -0,0 +1,148 @@
+#include "rendering/stream_buffer.hpp"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace scenegraphdemo {
+    constexpr unsigned int StreamBuffer::REGIONS;
+
+    // Regions are kept at a multiple of this many bytes, which covers the
+    // alignment any attribute or uniform block offset can need.
+    const std::size_t STREAM_REGION_ALIGNMENT = 256;
+
+    // Longest single wait on a fence before checking it again.
+    const GLuint64 STREAM_FENCE_TIMEOUT = 1000000000;
+
+    StreamBuffer::StreamBuffer(std::size_t regionSize) {
+        this->regionSize = std::max<std::size_t>(
+            (regionSize + STREAM_REGION_ALIGNMENT - 1) / STREAM_REGION_ALIGNMENT * STREAM_REGION_ALIGNMENT,
+            STREAM_REGION_ALIGNMENT);
+        this->persistent = GLEW_ARB_buffer_storage;
+        this->allocate();
+    }
+
+    StreamBuffer::~StreamBuffer() {
+        this->release();
+    }
+
+    void *StreamBuffer::map(std::size_t size) {
+        this->stats.frames++;
+        if (size > this->regionSize) {
+            // The old buffer lives on until the GPU is done with it, so there's
+            // no need to wait before replacing it.
+            std::size_t grown = this->regionSize;
+            while (grown < size) {
+                grown *= 2;
+            }
+            this->release();
+            this->regionSize = grown;
+            this->allocate();
+            this->stats.reallocations++;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, this->buffer);
+        if (this->persistent) {
+            this->region = (this->region + 1) % REGIONS;
+            this->waitForRegion(this->region);
+            return this->memory + this->region * this->regionSize;
+        }
+
+        glBufferData(GL_ARRAY_BUFFER, this->regionSize, nullptr, GL_STREAM_DRAW);
+        this->stats.orphans++;
+        void *memory = glMapBufferRange(GL_ARRAY_BUFFER, 0, this->regionSize,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (memory == nullptr) {
+            throw std::runtime_error("Cannot map stream buffer");
+        }
+        return memory;
+    }
+
+    void StreamBuffer::unmap() {
+        // Persistent mappings are coherent, so writes need no flushing.
+        if (!this->persistent) {
+            glBindBuffer(GL_ARRAY_BUFFER, this->buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+    }
+
+    void StreamBuffer::fence() {
+        if (this->persistent) {
+            if (this->fences[this->region] != nullptr) {
+                glDeleteSync(this->fences[this->region]);
+            }
+            this->fences[this->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+
+    unsigned int StreamBuffer::getBuffer() const {
+        return this->buffer;
+    }
+
+    std::size_t StreamBuffer::getOffset() const {
+        return this->persistent ? this->region * this->regionSize : 0;
+    }
+
+    bool StreamBuffer::isPersistent() const {
+        return this->persistent;
+    }
+
+    const StreamBufferStats &StreamBuffer::getStats() const {
+        return this->stats;
+    }
+
+    void StreamBuffer::allocate() {
+        glGenBuffers(1, &this->buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, this->buffer);
+        if (!this->persistent) {
+            glBufferData(GL_ARRAY_BUFFER, this->regionSize, nullptr, GL_STREAM_DRAW);
+            return;
+        }
+
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const std::size_t size = REGIONS * this->regionSize;
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        this->memory = static_cast<char *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+        if (this->memory == nullptr) {
+            throw std::runtime_error("Cannot map stream buffer");
+        }
+    }
+
+    void StreamBuffer::release() {
+        for (auto &fence : this->fences) {
+            if (fence != nullptr) {
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+        if (this->buffer != 0) {
+            // Deleting a buffer unmaps it.
+            glDeleteBuffers(1, &this->buffer);
+            this->buffer = 0;
+            this->memory = nullptr;
+        }
+    }
+
+    void StreamBuffer::waitForRegion(unsigned int index) {
+        GLsync fence = this->fences[index];
+        if (fence == nullptr) {
+            return;
+        }
+
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            const auto begin = std::chrono::steady_clock::now();
+            do {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, STREAM_FENCE_TIMEOUT);
+            } while (result == GL_TIMEOUT_EXPIRED);
+            this->stats.fenceStalls++;
+            this->stats.fenceStallTime += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - begin).count();
+        }
+        if (result == GL_WAIT_FAILED) {
+            throw std::runtime_error("Waiting on a stream buffer fence failed");
+        }
+        glDeleteSync(fence);
+        this->fences[index] = nullptr;
+    }
+}
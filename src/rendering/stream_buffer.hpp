@@ -0,0 +1,92 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+
+namespace scenegraphdemo {
+    // Counters describing how a stream buffer was used.
+    struct StreamBufferStats {
+        // Number of frames written.
+        std::size_t frames = 0;
+
+        // Frames that found the GPU still reading the region they were about
+        // to write, and the milliseconds spent waiting for it in total.
+        std::size_t fenceStalls = 0;
+        double fenceStallTime = 0.0;
+
+        // Number of times the buffer was recreated to fit a larger frame.
+        std::size_t reallocations = 0;
+
+        // Number of times the buffer was orphaned, which only happens when
+        // persistent mapping isn't available.
+        std::size_t orphans = 0;
+    };
+
+    // Buffer for data written by the CPU once per frame and read by the GPU
+    // in the same frame, such as per-instance transforms. Where
+    // ARB_buffer_storage is available the buffer is split into REGIONS
+    // regions and mapped once for good. Frames cycle through the regions, and
+    // a fence placed after each frame's draws tells when its region can be
+    // written again, so the CPU writes straight into memory the GPU reads and
+    // only waits when it gets REGIONS frames ahead. Elsewhere the buffer is
+    // orphaned and mapped each frame, leaving the renaming to the driver.
+    // All functions must be called on the OpenGL thread.
+    class StreamBuffer {
+    public:
+        // Number of frames that can be in flight at once.
+        static constexpr unsigned int REGIONS = 3;
+
+        // Creates a buffer whose regions hold regionSize bytes to begin with.
+        // Regions grow when a frame needs more.
+        StreamBuffer(std::size_t regionSize = 64 * 1024);
+        ~StreamBuffer();
+
+        StreamBuffer(const StreamBuffer &) = delete;
+        StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+        // Returns memory for size bytes of this frame's data, waiting for the
+        // GPU first if it still reads the region. The memory is write-only and
+        // may be uncached, so it should be written once, in order.
+        void *map(std::size_t size);
+
+        // Ends writing the frame's data. Must be called before drawing from
+        // the buffer.
+        void unmap();
+
+        // Marks the end of the draws reading the frame's data.
+        void fence();
+
+        // Returns the OpenGL buffer.
+        unsigned int getBuffer() const;
+
+        // Returns the offset of the frame's data within the buffer.
+        std::size_t getOffset() const;
+
+        // Returns whether the buffer is persistently mapped.
+        bool isPersistent() const;
+
+        // Returns the buffer's counters.
+        const StreamBufferStats &getStats() const;
+    private:
+        unsigned int buffer = 0;
+        std::size_t regionSize;
+        bool persistent;
+
+        // Persistently mapped memory of all regions, region being written and
+        // the fences of the draws reading each region.
+        char *memory = nullptr;
+        unsigned int region = 0;
+        GLsync fences[REGIONS] = {};
+
+        StreamBufferStats stats;
+
+        // Creates the OpenGL buffer with room for regionSize bytes per region.
+        void allocate();
+
+        // Deletes the OpenGL buffer and the fences.
+        void release();
+
+        // Waits until the GPU finished the draws reading a region.
+        void waitForRegion(unsigned int index);
+    };
+}
@@ -0,0 +1,180 @@
+#include "resources/asset_archive.hpp"
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#ifdef SCENEGRAPHDEMO_LZ4
+#include <lz4.h>
+#endif
+
+namespace scenegraphdemo {
+    std::uint64_t hashBytes(const char *data, std::size_t size) {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (std::size_t i = 0; i < size; i++) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::uint64_t hashAssetPath(const std::string &path) {
+        return hashBytes(path.data(), path.size());
+    }
+
+    AssetArchive::AssetArchive(const std::string &filename) :
+            filename(filename), file(filename, MappedFileAccess::RANDOM) {
+        const std::size_t fileSize = file.size();
+        if (fileSize < sizeof(ArchiveHeader)) {
+            throw std::runtime_error("Asset archive is truncated: " + filename);
+        }
+
+        ArchiveHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0) {
+            throw std::runtime_error("Not an asset archive: " + filename);
+        }
+        if (header.version != ARCHIVE_VERSION) {
+            throw std::runtime_error("Unsupported asset archive version " +
+                std::to_string(header.version) + ": " + filename);
+        }
+        if (header.indexOffset > fileSize ||
+                header.entryCount > (fileSize - header.indexOffset) / sizeof(ArchiveEntry) ||
+                header.pathsOffset > fileSize) {
+            throw std::runtime_error("Asset archive index is corrupt: " + filename);
+        }
+
+        // The index is small, so it's copied out rather than read in place,
+        // which also sidesteps alignment concerns.
+        entries.resize(header.entryCount);
+        std::memcpy(entries.data(), file.data() + header.indexOffset,
+            entries.size() * sizeof(ArchiveEntry));
+        paths = file.data() + header.pathsOffset;
+
+        const std::size_t pathsSize = fileSize - header.pathsOffset;
+        for (const auto &entry : entries) {
+            if (entry.offset > fileSize || entry.storedSize >= fileSize - entry.offset ||
+                    entry.pathOffset > pathsSize || entry.pathLength > pathsSize - entry.pathOffset ||
+                    (entry.compression == ArchiveCompression::NONE && entry.size != entry.storedSize)) {
+                throw std::runtime_error("Asset archive entry is corrupt: " + filename);
+            }
+        }
+    }
+
+    const ArchiveEntry *AssetArchive::find(const std::string &path) const {
+        const std::uint64_t hash = hashAssetPath(path);
+        auto it = std::lower_bound(entries.begin(), entries.end(), hash,
+            [](const ArchiveEntry &entry, std::uint64_t hash) {
+                return entry.pathHash < hash;
+            });
+
+        // Colliding hashes are told apart by their paths.
+        for (; it != entries.end() && it->pathHash == hash; ++it) {
+            if (it->pathLength == path.size() &&
+                    std::memcmp(paths + it->pathOffset, path.data(), path.size()) == 0) {
+                return &*it;
+            }
+        }
+        return nullptr;
+    }
+
+    const char *AssetArchive::view(const ArchiveEntry &entry) const {
+        if (entry.compression != ArchiveCompression::NONE) {
+            throw std::runtime_error("Cannot view compressed entry " + getPath(entry) +
+                " of asset archive: " + filename);
+        }
+        return file.data() + entry.offset;
+    }
+
+    void AssetArchive::read(const ArchiveEntry &entry, std::vector<char> &out) const {
+        const char *stored = file.data() + entry.offset;
+        switch (entry.compression) {
+        case ArchiveCompression::NONE:
+            out.assign(stored, stored + entry.size);
+            break;
+        case ArchiveCompression::LZ4:
+#ifdef SCENEGRAPHDEMO_LZ4
+            out.resize(entry.size);
+            if (LZ4_decompress_safe(stored, out.data(), entry.storedSize, entry.size) !=
+                    static_cast<int>(entry.size)) {
+                throw std::runtime_error("Cannot decompress entry " + getPath(entry) +
+                    " of asset archive: " + filename);
+            }
+            break;
+#else
+            throw std::runtime_error("Entry " + getPath(entry) + " of asset archive " + filename +
+                " is LZ4-compressed, but LZ4 support isn't built in");
+#endif
+        default:
+            throw std::runtime_error("Entry " + getPath(entry) + " of asset archive " + filename +
+                " uses an unknown compression");
+        }
+        out.push_back('\0');
+    }
+
+    std::string AssetArchive::getPath(const ArchiveEntry &entry) const {
+        return std::string(paths + entry.pathOffset, entry.pathLength);
+    }
+
+    const std::vector<ArchiveEntry> &AssetArchive::getEntries() const {
+        return entries;
+    }
+
+    // Archives mounted by mountArchive along with the directories they are
+    // mounted at, most recent last.
+    static std::mutex mountsMutex;
+    static std::vector<std::pair<std::string, std::shared_ptr<AssetArchive>>> mounts;
+
+    // Turns a path into an absolute one with forward slashes and without "."
+    // or ".." components, without touching the filesystem.
+    static std::string normalizePath(const std::string &path) {
+        std::string normalized = boost::filesystem::absolute(path).lexically_normal().generic_string();
+
+        // Paths ending in a separator normalize to a trailing ".".
+        const std::string trailingDot = "/.";
+        if (normalized.size() > trailingDot.size() &&
+                normalized.compare(normalized.size() - trailingDot.size(), trailingDot.size(), trailingDot) == 0) {
+            normalized.resize(normalized.size() - 1);
+        }
+        return normalized;
+    }
+
+    void mountArchive(std::shared_ptr<AssetArchive> archive, const std::string &directory) {
+        std::string prefix = normalizePath(directory);
+        if (prefix.empty() || prefix.back() != '/') {
+            prefix += '/';
+        }
+        std::lock_guard<std::mutex> lock(mountsMutex);
+        mounts.emplace_back(prefix, std::move(archive));
+    }
+
+    void unmountArchives() {
+        std::lock_guard<std::mutex> lock(mountsMutex);
+        mounts.clear();
+    }
+
+    MountedAsset findMountedAsset(const std::string &filename) {
+        MountedAsset asset;
+        std::lock_guard<std::mutex> lock(mountsMutex);
+        if (mounts.empty()) {
+            return asset;
+        }
+
+        const std::string path = normalizePath(filename);
+        for (auto mount = mounts.rbegin(); mount != mounts.rend(); ++mount) {
+            const std::string &prefix = mount->first;
+            if (path.compare(0, prefix.size(), prefix) != 0) {
+                continue;
+            }
+            const ArchiveEntry *entry = mount->second->find(path.substr(prefix.size()));
+            if (entry != nullptr) {
+                asset.archive = mount->second;
+                asset.entry = entry;
+                return asset;
+            }
+        }
+        return asset;
+    }
+}
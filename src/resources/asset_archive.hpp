@@ -0,0 +1,129 @@
+#pragma once
+
+#include "resources/mapped_file.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace scenegraphdemo {
+    // Archives are laid out as a header, the contents of every file, an index
+    // of entries sorted by path hash and finally a table of the paths the
+    // entries refer to. Contents start at ARCHIVE_ALIGNMENT byte boundaries
+    // and are always followed by at least one zero byte, so text can be used
+    // in place as a C string. The header and entries are written and read
+    // as the structs below, so integers are in host order, which every
+    // supported host keeps little-endian.
+    const char ARCHIVE_MAGIC[8] = {'S', 'G', 'D', 'P', 'A', 'C', 'K', '\0'};
+    const std::uint32_t ARCHIVE_VERSION = 1;
+    const std::size_t ARCHIVE_ALIGNMENT = 64;
+
+    // How an entry's contents are stored.
+    enum class ArchiveCompression : std::uint32_t {
+        NONE = 0,
+        LZ4 = 1,
+    };
+
+    struct ArchiveHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t entryCount;
+        std::uint64_t indexOffset;
+        std::uint64_t pathsOffset;
+    };
+
+    struct ArchiveEntry {
+        // Hash of the entry's path, see hashAssetPath.
+        std::uint64_t pathHash;
+
+        // Location and size of the stored contents.
+        std::uint64_t offset;
+        std::uint64_t storedSize;
+
+        // Size of the contents once decompressed.
+        std::uint64_t size;
+
+        // Location of the path in the path table.
+        std::uint32_t pathOffset;
+        std::uint32_t pathLength;
+
+        ArchiveCompression compression;
+        std::uint32_t reserved;
+    };
+
+    static_assert(sizeof(ArchiveHeader) == 32, "Archive header layout changed");
+    static_assert(sizeof(ArchiveEntry) == 48, "Archive entry layout changed");
+
+    // Archives packed on one host must be readable on another, so hosts that
+    // would store integers the other way round are refused outright.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Asset archives require a little-endian host"
+#endif
+
+    // Hashes a block of memory with 64-bit FNV-1a.
+    std::uint64_t hashBytes(const char *data, std::size_t size);
+
+    // Hashes a path relative to the archive root with hashBytes. Paths use
+    // forward slashes and no leading "./".
+    std::uint64_t hashAssetPath(const std::string &path);
+
+    // Read-only view of an asset archive. The archive is memory-mapped, so
+    // opening it only reads the index, and uncompressed contents are used
+    // straight from the mapping.
+    class AssetArchive {
+    public:
+        // Opens an archive. Throws a std::runtime_error if the file can't be
+        // mapped or isn't a valid archive.
+        AssetArchive(const std::string &filename);
+
+        AssetArchive(const AssetArchive &) = delete;
+        AssetArchive &operator=(const AssetArchive &) = delete;
+
+        // Returns the entry for a path relative to the archive root, or
+        // nullptr if the archive doesn't contain it.
+        const ArchiveEntry *find(const std::string &path) const;
+
+        // Returns the contents of an uncompressed entry inside the mapping.
+        // The contents are followed by a zero byte.
+        const char *view(const ArchiveEntry &entry) const;
+
+        // Copies an entry's contents into out, decompressing them if needed,
+        // and appends a zero byte. Throws a std::runtime_error if the entry is
+        // compressed with a codec that isn't available or is corrupt.
+        void read(const ArchiveEntry &entry, std::vector<char> &out) const;
+
+        // Returns the path of an entry.
+        std::string getPath(const ArchiveEntry &entry) const;
+
+        // Returns every entry, sorted by path hash.
+        const std::vector<ArchiveEntry> &getEntries() const;
+    private:
+        std::string filename;
+        MappedFile file;
+        std::vector<ArchiveEntry> entries;
+        const char *paths;
+    };
+
+    // Makes the files of an archive available to RawResource and
+    // ImageResource under a directory, as if the archive was extracted there.
+    // Mounted archives are searched before the filesystem, the most recently
+    // mounted first.
+    void mountArchive(std::shared_ptr<AssetArchive> archive, const std::string &directory);
+
+    // Unmounts every archive.
+    void unmountArchives();
+
+    // File found in a mounted archive.
+    struct MountedAsset {
+        std::shared_ptr<AssetArchive> archive;
+        const ArchiveEntry *entry = nullptr;
+
+        explicit operator bool() const {
+            return entry != nullptr;
+        }
+    };
+
+    // Looks a file up in the mounted archives. Safe to call from any thread.
+    MountedAsset findMountedAsset(const std::string &filename);
+}
@@ -1,45 +1,168 @@
 #include "GL/glew.h"
 #include "SDL2/SDL.h"
 #include "SDL2/SDL_image.h"
+#include "logging.hpp"
+#include "resources/asset_archive.hpp"
 #include "resources/image_resource.hpp"
+#include "resources/texture_cache.hpp"
+#include <algorithm>
 #include <stdexcept>
+#include <vector>
 
 namespace scenegraphdemo {
-    ImageResource::ImageResource(std::string filename) {
+    // Returns the number of bytes a texel of the given format takes up.
+    static std::size_t bytesPerPixelOf(GLint format) {
+        return format == GL_RGBA ? 4 : 3;
+    }
+
+    ImageResource::ImageResource() {
+    }
+
+    ImageResource::ImageResource(std::string filename, ImageResidency residency) {
         this->filename = filename;
+        this->residency = residency;
 
-        SDL_Surface *surface = IMG_Load(filename.c_str());
+        // Containers hold the decoded mip chain, so nothing is decoded or
+        // generated here. Failing to use the cache isn't fatal since the
+        // source can still be decoded.
+        std::shared_ptr<TextureCache> cache = TextureCache::getDefault();
+        if (cache) {
+            try {
+                this->container = cache->load(filename);
+            } catch (const std::runtime_error &e) {
+                scenegraphdemo::warn("Texture cache unavailable: ", e.what());
+            }
+        }
+        if (this->container) {
+            this->format = this->container->getFormat();
+            this->createTexture();
+            this->container->upload(this->container->getPixels());
+            glBindTexture(GL_TEXTURE_2D, 0);
+            const TextureLevel &level = this->container->getLevels().front();
+            this->finishUpload(level.width, level.height);
+            return;
+        }
+
+        SDL_Surface *surface = loadSurface(filename);
         if (!surface) {
             throw std::runtime_error("Unable to load image: " + filename);
         }
         this->surface = surface;
+        this->format = formatOf(surface, filename);
+
+        // Generate a texture id and load the texture into the GPU.
+        this->createTexture();
+        // https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glTexImage2D.xhtml
+        glTexImage2D(GL_TEXTURE_2D, 0, format, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        this->finishUpload(surface->w, surface->h);
+    }
+
+    ImageResource::~ImageResource() {
+        // Pixels are freed the same way whatever the residency, and the
+        // texture goes with them, so evicting an image returns its video
+        // memory as well. Uploads are staged through the loader's pixel
+        // buffer, so there's no buffer of the image's own to delete.
+        this->releasePixels();
+        glDeleteTextures(1, &this->texture);
+        this->texture = 0;
+    }
 
-        GLint format;
+    std::shared_ptr<ImageResource> ImageResource::createPlaceholder(std::string filename,
+            ImageResidency residency) {
+        std::shared_ptr<ImageResource> image(new ImageResource());
+        image->filename = filename;
+        image->format = GL_RGBA;
+        image->residency = residency;
+        image->width = 1;
+        image->height = 1;
+        image->gpuBytes = 4;
+
+        const unsigned char white[4] = {255, 255, 255, 255};
+        image->createTexture();
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return image;
+    }
+
+    SDL_Surface *ImageResource::loadSurface(const std::string &filename) {
+        MountedAsset asset = findMountedAsset(filename);
+        if (!asset) {
+            return IMG_Load(filename.c_str());
+        }
+
+        // Uncompressed images are decoded straight out of the archive.
+        std::vector<char> contents;
+        const char *data;
+        if (asset.entry->compression == ArchiveCompression::NONE) {
+            data = asset.archive->view(*asset.entry);
+        } else {
+            asset.archive->read(*asset.entry, contents);
+            data = contents.data();
+        }
+        return IMG_Load_RW(SDL_RWFromConstMem(data, asset.entry->size), 1);
+    }
+
+    GLint ImageResource::formatOf(const SDL_Surface *surface, const std::string &filename) {
         if (surface->format->BytesPerPixel == 4) {
-            format = GL_RGBA;
+            return GL_RGBA;
         } else if (surface->format->BytesPerPixel == 3) {
-            format = GL_RGB;
+            return GL_RGB;
         } else {
             throw std::runtime_error("Unsupported color format for image: " + filename);
         }
-        this->format = format;
+    }
 
-        // Generate a texture id and load the texture into the GPU.
+    void ImageResource::createTexture() {
         glGenTextures(1, &this->texture);
         this->bind();
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        // https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glTexImage2D.xhtml
-        glTexImage2D(GL_TEXTURE_2D, 0, format, surface->w, surface->h, 0, format, GL_UNSIGNED_BYTE, surface->pixels);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, 0);
     }
 
-    ImageResource::~ImageResource() {
+    void ImageResource::finishUpload(int width, int height) {
+        this->width = width;
+        this->height = height;
+
+        // Every level down to 1x1 is defined, either from a texture container
+        // or by glGenerateMipmap. Drivers may pad RGB texels to four bytes,
+        // so this is a lower bound.
+        this->gpuBytes = 0;
+        const std::size_t bytesPerPixel = bytesPerPixelOf(this->format);
+        while (true) {
+            this->gpuBytes += std::size_t(width) * height * bytesPerPixel;
+            if (width == 1 && height == 1) {
+                break;
+            }
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+
+        this->loaded = true;
+        if (this->residency != ImageResidency::KEEP) {
+            this->releasePixels();
+        }
+    }
+
+    void ImageResource::releasePixels() {
         SDL_FreeSurface(this->surface);
         this->surface = nullptr;
+        this->container.reset();
+        std::vector<char>().swap(this->readback);
+    }
+
+    void ImageResource::setResidency(ImageResidency residency) {
+        this->residency = residency;
+        if (this->loaded && residency != ImageResidency::KEEP) {
+            this->releasePixels();
+        }
+    }
+
+    ImageResidency ImageResource::getResidency() const {
+        return this->residency;
     }
 
     void ImageResource::bind(int texture) {
@@ -47,11 +170,64 @@ namespace scenegraphdemo {
         glBindTexture(GL_TEXTURE_2D, this->texture);
     }
 
+    unsigned int ImageResource::getTexture() const {
+        return this->texture;
+    }
+
+    int ImageResource::getWidth() const {
+        return this->width;
+    }
+
+    int ImageResource::getHeight() const {
+        return this->height;
+    }
+
+    GLint ImageResource::getFormat() const {
+        return this->format;
+    }
+
+    std::size_t ImageResource::getCpuByteSize() const {
+        if (container) {
+            return this->container->getPixelsSize();
+        } else if (surface) {
+            return this->surface->pitch * this->surface->h;
+        } else {
+            return this->readback.size();
+        }
+    }
+
+    std::size_t ImageResource::getGpuByteSize() const {
+        return this->gpuBytes;
+    }
+
+    std::size_t ImageResource::getByteSize() const {
+        return this->getCpuByteSize() + this->getGpuByteSize();
+    }
+
+    bool ImageResource::isLoaded() const {
+        return this->loaded;
+    }
+
     void *ImageResource::data() {
-        if (surface) {
+        if (container) {
+            return const_cast<char *>(this->container->getPixels());
+        } else if (surface) {
             return this->surface->pixels;
-        } else {
+        } else if (!readback.empty()) {
+            return this->readback.data();
+        } else if (!this->loaded || this->residency != ImageResidency::RELOAD) {
             return nullptr;
         }
+
+        // Read the largest level back from the texture. This waits for the
+        // GPU, so it's meant for the occasional access rather than every
+        // frame.
+        this->readback.resize(std::size_t(this->width) * this->height * bytesPerPixelOf(this->format));
+        this->bind();
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, this->format, GL_UNSIGNED_BYTE, this->readback.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return this->readback.data();
     }
 }
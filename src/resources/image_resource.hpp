@@ -4,26 +4,131 @@
 #include "SDL2/SDL.h"
 #include "SDL2/SDL_image.h"
 #include "resources/resource.hpp"
+#include "resources/texture_cache.hpp"
+#include <cstddef>
+#include <memory>
+#include <vector>
 
 namespace scenegraphdemo {
+    // What happens to an image's pixels in system memory once they've been
+    // uploaded to its texture.
+    enum class ImageResidency {
+        // Pixels stay in memory for the image's lifetime.
+        KEEP,
+
+        // Pixels are freed, and data() returns nullptr from then on.
+        RELEASE,
+
+        // Pixels are freed, and data() reads them back from the texture when
+        // they're needed again.
+        RELOAD,
+    };
+
     class ImageResource : public Resource {
     public:
-        ImageResource(std::string filename);
+        ImageResource(std::string filename, ImageResidency residency = ImageResidency::KEEP);
+
+        // Frees the pixels and deletes the texture, so images must be
+        // destroyed on the OpenGL thread.
         virtual ~ImageResource();
 
-        // Returns a pointer to file data stored in memory.
+        ImageResource(const ImageResource &) = delete;
+        ImageResource &operator=(const ImageResource &) = delete;
+
+        // Returns a pointer to file data stored in memory, or nullptr while
+        // the image is still loading or once its pixels were released. Images
+        // loaded from a texture container return the container's largest mip
+        // level, which is read-only. Pixels read back from the texture have
+        // tightly packed rows.
         void *data();
 
+        // Frees the pixels kept in system memory. The texture is unaffected.
+        void releasePixels();
+
+        // Changes what happens to the pixels after upload. Pixels that are
+        // already uploaded are freed right away unless the policy is KEEP.
+        void setResidency(ImageResidency residency);
+        ImageResidency getResidency() const;
+
         // Binds the texture for use with OpenGL.
         void bind(int texture = 0);
+
+        // Returns the OpenGL id of the texture. The id stays the same once the
+        // pixel data of an asynchronously loaded image arrives.
+        unsigned int getTexture() const;
+
+        // Returns the dimensions of the texture's largest level, which are
+        // those of the placeholder until the image is loaded.
+        int getWidth() const;
+        int getHeight() const;
+
+        // Returns the color format of the texture, GL_RGB or GL_RGBA.
+        GLint getFormat() const;
+
+        // Returns the size of the pixel data kept in system memory.
+        std::size_t getCpuByteSize() const;
+
+        // Returns an estimate of the video memory used by the texture and its
+        // mipmaps.
+        std::size_t getGpuByteSize() const;
+
+        // Returns the memory used by the image in total.
+        std::size_t getByteSize() const;
+
+        // Returns whether the image's pixel data is in the texture. Images
+        // loaded through a TextureLoader show a placeholder until then.
+        bool isLoaded() const;
     private:
+        friend class TextureLoader;
+
         // ID refering to a texture being managed by OpenGL.
-        unsigned int texture;
+        unsigned int texture = 0;
 
         // Color format the texture is using. This can either be RGB or RGBA.
         GLint format;
 
         // Contains raw pixel image data processed by SDL.
-        SDL_Surface *surface;
+        SDL_Surface *surface = nullptr;
+
+        // Mip chain the texture was defined from when a texture cache is in
+        // use, in place of surface.
+        std::unique_ptr<TextureContainer> container;
+
+        // Pixels read back from the texture under the RELOAD policy.
+        std::vector<char> readback;
+
+        // Set once the texture holds the image's pixel data.
+        bool loaded = false;
+
+        ImageResidency residency = ImageResidency::KEEP;
+
+        // Dimensions of the texture's largest level and the estimated size of
+        // its mip chain.
+        int width = 0;
+        int height = 0;
+        std::size_t gpuBytes = 0;
+
+        // Used by TextureLoader for images whose pixels arrive later.
+        ImageResource();
+
+        // Creates an image whose texture holds a single white texel until a
+        // TextureLoader uploads the decoded pixels.
+        static std::shared_ptr<ImageResource> createPlaceholder(std::string filename, ImageResidency residency);
+
+        // Decodes an image file, taking it from a mounted asset archive when
+        // one contains it. Returns nullptr on failure, with the reason left in
+        // SDL_GetError.
+        static SDL_Surface *loadSurface(const std::string &filename);
+
+        // Returns the OpenGL format matching a decoded surface. Throws if the
+        // surface's pixel format isn't supported.
+        static GLint formatOf(const SDL_Surface *surface, const std::string &filename);
+
+        // Generates the texture object and sets its sampling parameters.
+        void createTexture();
+
+        // Records that the texture holds the image's full mip chain and
+        // applies the residency policy to the pixels left in memory.
+        void finishUpload(int width, int height);
     };
 }
@@ -0,0 +1,80 @@
+#include "resources/mapped_file.hpp"
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace scenegraphdemo {
+    MappedFile::MappedFile(const std::string &filename, MappedFileAccess access) {
+        int file = open(filename.c_str(), O_RDONLY);
+        if (file < 0) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+
+        struct stat status;
+        if (fstat(file, &status) != 0) {
+            close(file);
+            throw std::runtime_error("Cannot read size of file: " + filename);
+        }
+        this->length = status.st_size;
+
+        // Zero-length mappings aren't allowed, and there's nothing to map.
+        if (this->length > 0) {
+            void *mapping = mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapping == MAP_FAILED) {
+                close(file);
+                throw std::runtime_error("Cannot map file: " + filename);
+            }
+            this->mapping = mapping;
+        }
+
+        // The mapping keeps its own reference to the file.
+        close(file);
+        this->advise(access);
+    }
+
+    MappedFile::~MappedFile() {
+        if (this->mapping != nullptr) {
+            munmap(this->mapping, this->length);
+        }
+    }
+
+    const char *MappedFile::data() const {
+        return static_cast<const char *>(this->mapping);
+    }
+
+    std::size_t MappedFile::size() const {
+        return this->length;
+    }
+
+    bool MappedFile::isTerminated() const {
+        static const std::size_t pageSize = sysconf(_SC_PAGESIZE);
+        return this->mapping != nullptr && this->length % pageSize != 0;
+    }
+
+    void MappedFile::advise(MappedFileAccess access) {
+        if (this->mapping == nullptr) {
+            return;
+        }
+
+        int advice = MADV_NORMAL;
+        switch (access) {
+        case MappedFileAccess::NORMAL:
+            advice = MADV_NORMAL;
+            break;
+        case MappedFileAccess::SEQUENTIAL:
+            advice = MADV_SEQUENTIAL;
+            break;
+        case MappedFileAccess::RANDOM:
+            advice = MADV_RANDOM;
+            break;
+        case MappedFileAccess::WILL_NEED:
+            advice = MADV_WILLNEED;
+            break;
+        }
+
+        // Hints are best effort, so failures are ignored.
+        madvise(this->mapping, this->length, advice);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace scenegraphdemo {
+    // Expected access pattern of a mapped file, passed on to the kernel so it
+    // can tune read-ahead.
+    enum class MappedFileAccess {
+        NORMAL,
+        SEQUENTIAL,
+        RANDOM,
+        // Like NORMAL, but asks for the whole file to be paged in ahead of
+        // time.
+        WILL_NEED,
+    };
+
+    // Read-only memory mapping of a whole file. Pages are read from disk on
+    // first access instead of being copied into a buffer up front, and clean
+    // pages can be dropped by the kernel under memory pressure.
+    class MappedFile {
+    public:
+        // Maps a file. Throws a std::runtime_error if the file can't be
+        // opened or mapped.
+        MappedFile(const std::string &filename, MappedFileAccess access = MappedFileAccess::SEQUENTIAL);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        // Returns the start of the mapping, or nullptr for empty files.
+        const char *data() const;
+
+        // Returns the size of the file in bytes.
+        std::size_t size() const;
+
+        // Returns whether the byte following the file's contents can be read
+        // and is zero. Mappings are padded with zeros up to the end of the
+        // last page, so this holds unless the size is a multiple of the page
+        // size.
+        bool isTerminated() const;
+
+        // Changes the access pattern hint for the mapping.
+        void advise(MappedFileAccess access);
+    private:
+        void *mapping = nullptr;
+        std::size_t length = 0;
+    };
+}
@@ -0,0 +1,122 @@
+#include "logging.hpp"
+#include "rendering/renderable.hpp"
+#include "resources/mesh.hpp"
+#include "resources/raw_resource.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace scenegraphdemo {
+    Mesh::Mesh(std::string filename) : Mesh(filename, std::vector<std::string>{filename}) {}
+
+    Mesh::Mesh(std::string name, const std::vector<std::string> &filenames) : Resource(name) {
+        MeshData packed;
+        for (const auto &filename : filenames) {
+            // The file is mapped since it's only read once, here.
+            RawResource file(filename, RawResourceMode::MAP);
+            MeshPart part;
+            part.filename = filename;
+            const MeshData data = importObj(file.c_str(), filename, part.stats);
+            scenegraphdemo::info("Imported ", filename, ": ", part.stats.corners, " corners merged into ",
+                part.stats.vertices, " vertices for ", part.stats.triangles, " triangles, ACMR ",
+                part.stats.sourceCache.acmr, " -> ", part.stats.optimizedCache.acmr, ", cache hit rate ",
+                part.stats.sourceCache.hitRate, " -> ", part.stats.optimizedCache.hitRate, ", ",
+                part.stats.unindexedBytes, " -> ", part.stats.bytes, " bytes in ", part.stats.importTime, " ms");
+
+            // Indices are offset to the part's vertices, so parts are drawn
+            // without a base vertex.
+            const std::uint32_t baseVertex = static_cast<std::uint32_t>(packed.vertices.size());
+            part.firstIndex = static_cast<int>(packed.indices.size());
+            part.indexCount = static_cast<int>(data.indices.size());
+            packed.vertices.insert(packed.vertices.end(), data.vertices.begin(), data.vertices.end());
+            for (auto index : data.indices) {
+                packed.indices.push_back(baseVertex + index);
+            }
+            this->parts.push_back(part);
+        }
+        this->upload(packed);
+    }
+
+    Mesh::~Mesh() {
+        glDeleteVertexArrays(1, &this->vertexArray);
+        glDeleteBuffers(1, &this->indexBuffer);
+        glDeleteBuffers(1, &this->vertexBuffer);
+    }
+
+    void Mesh::upload(const MeshData &data) {
+        this->vertexCount = data.vertices.size();
+        this->indexCount = data.indices.size();
+
+        glGenVertexArrays(1, &this->vertexArray);
+        glBindVertexArray(this->vertexArray);
+
+        glGenBuffers(1, &this->vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, this->vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, data.vertices.size() * sizeof(MeshVertex), data.vertices.data(),
+            GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex),
+            reinterpret_cast<void *>(offsetof(MeshVertex, position)));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex),
+            reinterpret_cast<void *>(offsetof(MeshVertex, uv)));
+        glEnableVertexAttribArray(1);
+
+        // The element array binding is part of the vertex array's state. Small
+        // meshes use 16-bit indices, halving the index buffer.
+        glGenBuffers(1, &this->indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+        if (indexSizeOf(data.vertices.size()) == sizeof(std::uint16_t)) {
+            const std::vector<std::uint16_t> indices(data.indices.begin(), data.indices.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(std::uint16_t), indices.data(),
+                GL_STATIC_DRAW);
+            this->indexType = GL_UNSIGNED_SHORT;
+        } else {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.indices.size() * sizeof(std::uint32_t), data.indices.data(),
+                GL_STATIC_DRAW);
+            this->indexType = GL_UNSIGNED_INT;
+        }
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void Mesh::assign(Renderable &renderable) const {
+        renderable.vertexArray = this->vertexArray;
+        renderable.indexType = this->indexType;
+        renderable.firstVertex = 0;
+        renderable.vertexCount = this->indexCount;
+    }
+
+    void Mesh::assign(Renderable &renderable, std::size_t part) const {
+        renderable.vertexArray = this->vertexArray;
+        renderable.indexType = this->indexType;
+        renderable.firstVertex = this->parts.at(part).firstIndex;
+        renderable.vertexCount = this->parts.at(part).indexCount;
+    }
+
+    unsigned int Mesh::getVertexArray() const {
+        return this->vertexArray;
+    }
+
+    GLenum Mesh::getIndexType() const {
+        return this->indexType;
+    }
+
+    int Mesh::getIndexCount() const {
+        return this->indexCount;
+    }
+
+    int Mesh::getVertexCount() const {
+        return this->vertexCount;
+    }
+
+    std::size_t Mesh::getByteSize() const {
+        return this->vertexCount * sizeof(MeshVertex) +
+            this->indexCount * (this->indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t));
+    }
+
+    const std::vector<MeshPart> &Mesh::getParts() const {
+        return this->parts;
+    }
+}
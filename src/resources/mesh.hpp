@@ -0,0 +1,83 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "resources/mesh_import.hpp"
+#include "resources/resource.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace scenegraphdemo {
+    struct Renderable;
+
+    // One of the meshes packed into a Mesh, drawn from its own range of the
+    // index buffer.
+    struct MeshPart {
+        // File the part was imported from.
+        std::string filename;
+
+        // Range of the part's indices, which point straight at its vertices
+        // in the shared vertex buffer.
+        int firstIndex = 0;
+        int indexCount = 0;
+
+        // Counters of the part's import.
+        MeshImportStats stats;
+    };
+
+    // Indexed triangle mesh in a vertex array of its own, holding an
+    // interleaved vertex buffer and an index buffer. Vertices are merged and
+    // triangles reordered for the post-transform cache when the mesh is
+    // imported, so the vertex shader runs as few times as possible. Several
+    // meshes can be packed into one vertex array as parts, so they can be
+    // drawn by a single indirect call.
+    class Mesh : public Resource {
+    public:
+        // Imports a Wavefront OBJ file, taking it from a mounted asset archive
+        // when one contains it. Throws std::runtime_error if the file can't
+        // be read or parsed.
+        Mesh(std::string filename);
+
+        // Imports several OBJ files in the same way, one part each. Every
+        // part is optimized on its own, so its range of the index buffer
+        // always holds whole triangles of that part alone.
+        Mesh(std::string name, const std::vector<std::string> &filenames);
+        virtual ~Mesh();
+
+        Mesh(const Mesh &) = delete;
+        Mesh &operator=(const Mesh &) = delete;
+
+        // Points a renderable at the whole mesh.
+        void assign(Renderable &renderable) const;
+
+        // Points a renderable at a single part.
+        void assign(Renderable &renderable, std::size_t part) const;
+
+        // Returns the OpenGL id of the vertex array.
+        unsigned int getVertexArray() const;
+
+        // Returns the type of the indices, GL_UNSIGNED_SHORT or
+        // GL_UNSIGNED_INT.
+        GLenum getIndexType() const;
+
+        int getIndexCount() const;
+        int getVertexCount() const;
+
+        // Returns the video memory used by the vertex and index buffers.
+        std::size_t getByteSize() const;
+
+        // Returns the parts in the order their files were given.
+        const std::vector<MeshPart> &getParts() const;
+    private:
+        unsigned int vertexArray = 0;
+        unsigned int vertexBuffer = 0;
+        unsigned int indexBuffer = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+        int indexCount = 0;
+        int vertexCount = 0;
+        std::vector<MeshPart> parts;
+
+        // Creates the buffers and vertex array and fills them.
+        void upload(const MeshData &data);
+    };
+}
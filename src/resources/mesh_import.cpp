@@ -0,0 +1,388 @@
+#include "resources/asset_archive.hpp"
+#include "resources/mesh_import.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace scenegraphdemo {
+    // Stand-in for vertices that never entered the cache or were never used.
+    const std::uint32_t NO_VERTEX = UINT32_MAX;
+
+    // Reads one corner of an OBJ face, "v", "v/vt", "v//vn" or "v/vt/vn", and
+    // returns its position and texture coordinate indices, counted from 0.
+    // The texture coordinate index is -1 if the corner has none.
+    static bool parseCorner(const char *&cursor, long positionCount, long uvCount, long &position, long &uv) {
+        char *end;
+        position = std::strtol(cursor, &end, 10);
+        if (end == cursor) {
+            return false;
+        }
+        cursor = end;
+        uv = 0;
+        if (*cursor == '/') {
+            cursor++;
+            if (*cursor != '/') {
+                uv = std::strtol(cursor, &end, 10);
+                cursor = end;
+            }
+            if (*cursor == '/') {
+                cursor++;
+                std::strtol(cursor, &end, 10);
+                cursor = end;
+            }
+        }
+
+        // Negative indices count back from the last element read so far.
+        position = position < 0 ? positionCount + position : position - 1;
+        uv = uv < 0 ? uvCount + uv : uv - 1;
+        return position >= 0 && position < positionCount && uv < uvCount;
+    }
+
+    MeshData parseObj(const char *text, const std::string &filename) {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> uvs;
+        MeshData mesh;
+
+        std::string line;
+        std::vector<MeshVertex> polygon;
+        const char *lineBegin = text;
+        while (*lineBegin != '\0') {
+            const char *lineEnd = std::strchr(lineBegin, '\n');
+            if (lineEnd == nullptr) {
+                lineEnd = lineBegin + std::strlen(lineBegin);
+            }
+
+            // Lines are copied so number parsing can't run on into the next
+            // one.
+            line.assign(lineBegin, lineEnd);
+            lineBegin = *lineEnd == '\0' ? lineEnd : lineEnd + 1;
+            const char *cursor = line.c_str();
+            while (*cursor == ' ' || *cursor == '\t') {
+                cursor++;
+            }
+
+            if (std::strncmp(cursor, "v ", 2) == 0) {
+                char *end;
+                glm::vec3 position;
+                position.x = std::strtof(cursor + 2, &end);
+                position.y = std::strtof(end, &end);
+                position.z = std::strtof(end, &end);
+                positions.push_back(position);
+            } else if (std::strncmp(cursor, "vt ", 3) == 0) {
+                char *end;
+                glm::vec2 uv;
+                uv.x = std::strtof(cursor + 3, &end);
+                uv.y = std::strtof(end, &end);
+                uvs.push_back(uv);
+            } else if (std::strncmp(cursor, "f ", 2) == 0) {
+                cursor += 2;
+                polygon.clear();
+                while (true) {
+                    while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r') {
+                        cursor++;
+                    }
+                    if (*cursor == '\0') {
+                        break;
+                    }
+                    long position, uv;
+                    if (!parseCorner(cursor, positions.size(), uvs.size(), position, uv)) {
+                        throw std::runtime_error("Malformed face in " + filename + ": " + line);
+                    }
+                    polygon.push_back(MeshVertex{positions[position], uv >= 0 ? uvs[uv] : glm::vec2(0.0f)});
+                }
+                if (polygon.size() < 3) {
+                    throw std::runtime_error("Face with fewer than three corners in " + filename + ": " + line);
+                }
+                for (std::size_t i = 2; i < polygon.size(); i++) {
+                    mesh.vertices.push_back(polygon[0]);
+                    mesh.vertices.push_back(polygon[i - 1]);
+                    mesh.vertices.push_back(polygon[i]);
+                }
+            }
+        }
+
+        mesh.indices.resize(mesh.vertices.size());
+        for (std::size_t i = 0; i < mesh.indices.size(); i++) {
+            mesh.indices[i] = i;
+        }
+        return mesh;
+    }
+
+    void deduplicateVertices(MeshData &mesh) {
+        // Vertices are compared bit for bit. Hashes that collide with a
+        // different vertex probe the next hash.
+        std::unordered_map<std::uint64_t, std::uint32_t> unique;
+        unique.reserve(mesh.vertices.size());
+        std::vector<MeshVertex> vertices;
+        std::vector<std::uint32_t> remap(mesh.vertices.size());
+        for (std::size_t i = 0; i < mesh.vertices.size(); i++) {
+            const MeshVertex &vertex = mesh.vertices[i];
+            std::uint64_t hash = hashBytes(reinterpret_cast<const char *>(&vertex), sizeof(MeshVertex));
+            while (true) {
+                auto inserted = unique.emplace(hash, static_cast<std::uint32_t>(vertices.size()));
+                if (inserted.second) {
+                    remap[i] = vertices.size();
+                    vertices.push_back(vertex);
+                    break;
+                }
+                if (std::memcmp(&vertices[inserted.first->second], &vertex, sizeof(MeshVertex)) == 0) {
+                    remap[i] = inserted.first->second;
+                    break;
+                }
+                hash++;
+            }
+        }
+
+        for (auto &index : mesh.indices) {
+            index = remap[index];
+        }
+        mesh.vertices.swap(vertices);
+    }
+
+    std::vector<std::size_t> optimizeVertexCache(std::vector<std::uint32_t> &indices, std::size_t vertexCount,
+            unsigned int cacheSize) {
+        const std::size_t triangleCount = indices.size() / 3;
+        std::vector<std::size_t> clusters;
+        if (triangleCount == 0) {
+            return clusters;
+        }
+
+        // Triangles using each vertex, as ranges of one shared array.
+        std::vector<std::uint32_t> liveTriangles(vertexCount, 0);
+        for (auto index : indices) {
+            liveTriangles[index]++;
+        }
+        std::vector<std::size_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (std::size_t vertex = 0; vertex < vertexCount; vertex++) {
+            adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+        }
+        std::vector<std::uint32_t> adjacency(indices.size());
+        std::vector<std::size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (std::size_t i = 0; i < indices.size(); i++) {
+            adjacency[fill[indices[i]]++] = i / 3;
+        }
+
+        // A vertex is in the cache while fewer than cacheSize vertices entered
+        // it after the vertex did.
+        std::vector<std::size_t> cacheTime(vertexCount, 0);
+        std::size_t timestamp = cacheSize + 1;
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<std::uint32_t> deadEnds;
+        std::vector<std::uint32_t> candidates;
+        std::vector<std::uint32_t> output;
+        output.reserve(indices.size());
+        std::size_t cursor = 0;
+        std::uint32_t fan = indices[0];
+        clusters.push_back(0);
+
+        while (fan != NO_VERTEX) {
+            // Emit every triangle left around the fanning vertex.
+            candidates.clear();
+            for (std::size_t i = adjacencyOffsets[fan]; i < adjacencyOffsets[fan + 1]; i++) {
+                const std::uint32_t triangle = adjacency[i];
+                if (emitted[triangle]) {
+                    continue;
+                }
+                for (unsigned int corner = 0; corner < 3; corner++) {
+                    const std::uint32_t vertex = indices[triangle * 3 + corner];
+                    output.push_back(vertex);
+                    deadEnds.push_back(vertex);
+                    candidates.push_back(vertex);
+                    liveTriangles[vertex]--;
+                    if (timestamp - cacheTime[vertex] > cacheSize) {
+                        cacheTime[vertex] = timestamp++;
+                    }
+                }
+                emitted[triangle] = true;
+            }
+
+            // Fan next around the candidate that entered the cache earliest
+            // and will still be in it once its own triangles are emitted.
+            std::uint32_t next = NO_VERTEX;
+            long bestPriority = -1;
+            for (auto vertex : candidates) {
+                if (liveTriangles[vertex] == 0) {
+                    continue;
+                }
+                long priority = 0;
+                if (timestamp - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+                    priority = timestamp - cacheTime[vertex];
+                }
+                if (priority > bestPriority) {
+                    bestPriority = priority;
+                    next = vertex;
+                }
+            }
+            if (next != NO_VERTEX) {
+                fan = next;
+                continue;
+            }
+
+            // Dead end. Back up through recently used vertices, and failing
+            // that take the next vertex in input order, which starts a new
+            // cluster.
+            while (!deadEnds.empty() && next == NO_VERTEX) {
+                const std::uint32_t vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[vertex] > 0) {
+                    next = vertex;
+                }
+            }
+            while (cursor < vertexCount && next == NO_VERTEX) {
+                if (liveTriangles[cursor] > 0) {
+                    next = cursor;
+                }
+                cursor++;
+            }
+            if (next != NO_VERTEX) {
+                clusters.push_back(output.size() / 3);
+            }
+            fan = next;
+        }
+
+        indices.swap(output);
+        return clusters;
+    }
+
+    bool optimizeOverdraw(MeshData &mesh, const std::vector<std::size_t> &clusters, float threshold,
+            unsigned int cacheSize) {
+        const std::size_t triangleCount = mesh.indices.size() / 3;
+        if (clusters.size() < 2) {
+            return false;
+        }
+
+        // Area weighted centroid and normal of every cluster, and the
+        // centroid of the whole mesh.
+        struct Cluster {
+            std::size_t begin;
+            std::size_t end;
+            glm::vec3 centroid;
+            glm::vec3 normal;
+            float score;
+        };
+        std::vector<Cluster> sorted;
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        for (std::size_t i = 0; i < clusters.size(); i++) {
+            Cluster cluster{clusters[i], i + 1 < clusters.size() ? clusters[i + 1] : triangleCount,
+                glm::vec3(0.0f), glm::vec3(0.0f), 0.0f};
+            float area = 0.0f;
+            for (std::size_t triangle = cluster.begin; triangle < cluster.end; triangle++) {
+                const glm::vec3 &a = mesh.vertices[mesh.indices[triangle * 3]].position;
+                const glm::vec3 &b = mesh.vertices[mesh.indices[triangle * 3 + 1]].position;
+                const glm::vec3 &c = mesh.vertices[mesh.indices[triangle * 3 + 2]].position;
+                const glm::vec3 normal = glm::cross(b - a, c - a);
+                const float triangleArea = glm::length(normal) * 0.5f;
+                cluster.centroid += (a + b + c) * (triangleArea / 3.0f);
+                cluster.normal += normal;
+                area += triangleArea;
+            }
+            meshCentroid += cluster.centroid;
+            meshArea += area;
+            if (area > 0.0f) {
+                cluster.centroid /= area;
+            }
+            sorted.push_back(cluster);
+        }
+        if (meshArea > 0.0f) {
+            meshCentroid /= meshArea;
+        }
+
+        for (auto &cluster : sorted) {
+            const float length = glm::length(cluster.normal);
+            const glm::vec3 normal = length > 0.0f ? cluster.normal / length : glm::vec3(0.0f);
+            cluster.score = glm::dot(cluster.centroid - meshCentroid, normal);
+        }
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b) {
+            return a.score > b.score;
+        });
+
+        std::vector<std::uint32_t> indices;
+        indices.reserve(mesh.indices.size());
+        for (const auto &cluster : sorted) {
+            indices.insert(indices.end(), mesh.indices.begin() + cluster.begin * 3,
+                mesh.indices.begin() + cluster.end * 3);
+        }
+        const double before = analyzeVertexCache(mesh.indices, mesh.vertices.size(), cacheSize).acmr;
+        const double after = analyzeVertexCache(indices, mesh.vertices.size(), cacheSize).acmr;
+        if (after > before * threshold) {
+            return false;
+        }
+        mesh.indices.swap(indices);
+        return true;
+    }
+
+    void optimizeVertexFetch(MeshData &mesh) {
+        std::vector<std::uint32_t> remap(mesh.vertices.size(), NO_VERTEX);
+        std::vector<MeshVertex> vertices;
+        vertices.reserve(mesh.vertices.size());
+        for (auto &index : mesh.indices) {
+            if (remap[index] == NO_VERTEX) {
+                remap[index] = vertices.size();
+                vertices.push_back(mesh.vertices[index]);
+            }
+            index = remap[index];
+        }
+        mesh.vertices.swap(vertices);
+    }
+
+    VertexCacheStats analyzeVertexCache(const std::vector<std::uint32_t> &indices, std::size_t vertexCount,
+            unsigned int cacheSize) {
+        VertexCacheStats stats;
+        if (indices.empty()) {
+            return stats;
+        }
+
+        // Same timestamp scheme as optimizeVertexCache, with every vertex
+        // starting out of the cache.
+        std::vector<std::size_t> cacheTime(vertexCount, 0);
+        std::vector<bool> used(vertexCount, false);
+        std::size_t timestamp = cacheSize + 1;
+        std::size_t misses = 0;
+        std::size_t usedCount = 0;
+        for (auto index : indices) {
+            if (timestamp - cacheTime[index] > cacheSize) {
+                cacheTime[index] = timestamp++;
+                misses++;
+            }
+            if (!used[index]) {
+                used[index] = true;
+                usedCount++;
+            }
+        }
+
+        stats.acmr = (double)misses / (indices.size() / 3);
+        stats.atvr = (double)misses / usedCount;
+        stats.hitRate = 1.0 - (double)misses / indices.size();
+        return stats;
+    }
+
+    std::size_t indexSizeOf(std::size_t vertexCount) {
+        return vertexCount <= 0x10000 ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+    }
+
+    MeshData importObj(const char *text, const std::string &filename, MeshImportStats &stats) {
+        const auto begin = std::chrono::steady_clock::now();
+        MeshData mesh = parseObj(text, filename);
+        stats.corners = mesh.vertices.size();
+        deduplicateVertices(mesh);
+        stats.sourceCache = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+        const std::vector<std::size_t> clusters = optimizeVertexCache(mesh.indices, mesh.vertices.size());
+        stats.overdrawSorted = optimizeOverdraw(mesh, clusters);
+        optimizeVertexFetch(mesh);
+        stats.optimizedCache = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+        stats.vertices = mesh.vertices.size();
+        stats.triangles = mesh.indices.size() / 3;
+        stats.unindexedBytes = stats.corners * sizeof(MeshVertex);
+        stats.bytes = stats.vertices * sizeof(MeshVertex) + mesh.indices.size() * indexSizeOf(stats.vertices);
+        stats.importTime = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - begin).count();
+        return mesh;
+    }
+}
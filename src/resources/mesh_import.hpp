@@ -0,0 +1,107 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace scenegraphdemo {
+    // Number of entries in the post-transform vertex cache that meshes are
+    // optimized for and measured against. Hardware caches vary, but orders
+    // tuned for a small FIFO hold up on larger ones.
+    const unsigned int VERTEX_CACHE_SIZE = 16;
+
+    // Vertex layout of imported meshes, matching attribute location 0 for the
+    // position and 1 for the texture coordinates.
+    struct MeshVertex {
+        glm::vec3 position;
+        glm::vec2 uv;
+    };
+
+    // Indexed triangle list.
+    struct MeshData {
+        std::vector<MeshVertex> vertices;
+        std::vector<std::uint32_t> indices;
+    };
+
+    // How well an index order uses a simulated FIFO post-transform cache.
+    struct VertexCacheStats {
+        // Vertex shader invocations per triangle, from 0.5 for ideal meshes
+        // to 3 when nothing is reused.
+        double acmr = 0.0;
+
+        // Vertex shader invocations per vertex, 1 when every vertex is only
+        // transformed once.
+        double atvr = 0.0;
+
+        // Share of indices found in the cache.
+        double hitRate = 0.0;
+    };
+
+    // Counters describing a mesh import.
+    struct MeshImportStats {
+        // Number of triangle corners read from the file, each of which would
+        // be a vertex of its own without an index buffer.
+        std::size_t corners = 0;
+
+        // Number of unique vertices and triangles left.
+        std::size_t vertices = 0;
+        std::size_t triangles = 0;
+
+        // Cache use of the index order found in the file and of the order
+        // the mesh is drawn in.
+        VertexCacheStats sourceCache;
+        VertexCacheStats optimizedCache;
+
+        // Whether triangles were reordered to reduce overdraw. It's skipped
+        // when it would cost too much cache efficiency.
+        bool overdrawSorted = false;
+
+        // Bytes the mesh would take as an unindexed vertex list, and bytes its
+        // vertex and index buffers take.
+        std::size_t unindexedBytes = 0;
+        std::size_t bytes = 0;
+
+        // Milliseconds spent parsing and optimizing.
+        double importTime = 0.0;
+    };
+
+    // Parses Wavefront OBJ text into one vertex per triangle corner, with
+    // polygons split into fans. Positions and texture coordinates are kept,
+    // everything else is ignored. Throws std::runtime_error naming filename
+    // on malformed faces.
+    MeshData parseObj(const char *text, const std::string &filename);
+
+    // Merges identical vertices and points the indices at the survivors.
+    void deduplicateVertices(MeshData &mesh);
+
+    // Reorders triangles for the post-transform cache with Tipsify, which
+    // fans around vertices in the order they entered the cache. Returns the
+    // index of the first triangle of every cluster, which start wherever
+    // the walk had to jump to a vertex outside the cache.
+    std::vector<std::size_t> optimizeVertexCache(std::vector<std::uint32_t> &indices, std::size_t vertexCount,
+        unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+    // Sorts the clusters found by optimizeVertexCache so ones facing away
+    // from the mesh's center come first, which are the ones most likely to
+    // hide the others. The new order is kept unless it raises the ACMR by
+    // more than threshold times. Returns whether it was kept.
+    bool optimizeOverdraw(MeshData &mesh, const std::vector<std::size_t> &clusters, float threshold = 1.05f,
+        unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+    // Reorders vertices by first use in the index buffer so they're fetched
+    // sequentially, and drops unused ones.
+    void optimizeVertexFetch(MeshData &mesh);
+
+    // Runs an index buffer through a simulated FIFO cache.
+    VertexCacheStats analyzeVertexCache(const std::vector<std::uint32_t> &indices, std::size_t vertexCount,
+        unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+    // Returns the size of the smallest index type able to address a number
+    // of vertices.
+    std::size_t indexSizeOf(std::size_t vertexCount);
+
+    // Parses an OBJ file's text and runs every optimization over it.
+    MeshData importObj(const char *text, const std::string &filename, MeshImportStats &stats);
+}
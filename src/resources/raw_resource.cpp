@@ -3,9 +3,33 @@
 #include <cstddef>
 
 namespace scenegraphdemo {
-    RawResource::RawResource(std::string filename) {
+    RawResource::RawResource(std::string filename, RawResourceMode mode) {
         this->filename = filename;
 
+        MountedAsset asset = findMountedAsset(filename);
+        if (asset) {
+            if (asset.entry->compression == ArchiveCompression::NONE) {
+                this->archive = asset.archive;
+                this->begin = this->archive->view(*asset.entry);
+                this->length = asset.entry->size;
+                this->terminated = this->begin[this->length] == '\0';
+            } else {
+                asset.archive->read(*asset.entry, this->contents);
+                this->begin = this->contents.data();
+                this->length = this->contents.size() - 1;
+                this->terminated = true;
+            }
+            return;
+        }
+
+        if (mode == RawResourceMode::MAP) {
+            this->mapped.reset(new MappedFile(filename));
+            this->begin = this->mapped->data();
+            this->length = this->mapped->size();
+            this->terminated = this->mapped->isTerminated();
+            return;
+        }
+
         std::ifstream file(filename, std::ios::binary);
         if (!file.is_open() || file.eof() || file.fail()) {
             throw std::runtime_error("Cannot open file: " + filename);
@@ -22,12 +46,32 @@ namespace scenegraphdemo {
         // Add null terminator so the data can be reinterpreted as a char array
         // and we don't need to worry about accidental overflow.
         this->contents[this->contents.size() - 1] = '\0';
+        this->begin = this->contents.data();
+        this->length = fileSize;
+        this->terminated = true;
     }
 
     RawResource::~RawResource() {
     }
 
-    const char *RawResource::data() {
-        return this->contents.data();
+    const char *RawResource::data() const {
+        return this->begin;
+    }
+
+    const char *RawResource::c_str() const {
+        if (this->terminated) {
+            return this->begin;
+        }
+
+        // Mapped files filling their last page exactly, or empty ones.
+        if (this->terminatedCopy.empty()) {
+            this->terminatedCopy.assign(this->begin, this->begin + this->length);
+            this->terminatedCopy.push_back('\0');
+        }
+        return this->terminatedCopy.data();
+    }
+
+    std::size_t RawResource::size() const {
+        return this->length;
     }
 }
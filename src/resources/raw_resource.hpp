@@ -1,20 +1,65 @@
 #pragma once
 
+#include "resources/asset_archive.hpp"
+#include "resources/mapped_file.hpp"
 #include "resources/resource.hpp"
+#include <cstddef>
+#include <memory>
 #include <vector>
 
 namespace scenegraphdemo {
+    // How a RawResource gets at the contents of its file.
+    enum class RawResourceMode {
+        // Reads the file into memory up front.
+        READ,
+
+        // Maps the file into memory, so it isn't copied and pages are only
+        // read from disk when they're touched.
+        MAP,
+    };
+
     class RawResource : public Resource {
     public:
-        RawResource(std::string filename);
+        // Loads a file. Files found in a mounted asset archive are taken from
+        // the archive regardless of mode, and used in place unless they're
+        // compressed.
+        RawResource(std::string filename, RawResourceMode mode = RawResourceMode::READ);
         virtual ~RawResource();
 
-        // Returns a pointer to file data stored in memory. This data is stored
-        // in the contents vector in a contiguous fashion as guaranteed by the
-        // C++ standard.
-        const char *data();
+        RawResource(const RawResource &) = delete;
+        RawResource &operator=(const RawResource &) = delete;
+
+        // Returns a pointer to the file's contents, which span size() bytes.
+        // For mapped files this is a view into the mapping and may not be
+        // followed by a null terminator, so use c_str() for text.
+        const char *data() const;
+
+        // Returns the file's contents as a null-terminated string. Mapped
+        // files are only copied to add the terminator when the mapping
+        // doesn't already end with one.
+        const char *c_str() const;
+
+        // Returns the size of the file in bytes.
+        std::size_t size() const;
     private:
-        // Buffer containing the contents of a file referenced by filename.
+        // Start and size of the contents, wherever they're kept.
+        const char *begin = nullptr;
+        std::size_t length = 0;
+
+        // Whether the contents are followed by a null terminator.
+        bool terminated = false;
+
+        // Buffer containing the contents of a file referenced by filename
+        // when it's read or decompressed, followed by a null terminator.
         std::vector<char> contents;
+
+        // Mapping of the file when it's mapped.
+        std::unique_ptr<MappedFile> mapped;
+
+        // Archive holding the contents when they're used in place.
+        std::shared_ptr<AssetArchive> archive;
+
+        // Null-terminated copy of the contents, made on demand by c_str().
+        mutable std::vector<char> terminatedCopy;
     };
 }
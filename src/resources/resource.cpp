@@ -10,4 +10,8 @@ namespace scenegraphdemo {
 
     Resource::~Resource() {
     }
+
+    const std::string &Resource::getFilename() const {
+        return this->filename;
+    }
 }
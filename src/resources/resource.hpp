@@ -8,6 +8,9 @@ namespace scenegraphdemo {
         Resource();
         Resource(std::string filename);
         virtual ~Resource();
+
+        // Returns the path the resource was loaded from.
+        const std::string &getFilename() const;
     protected:
         // Path to the file that pertains to the data held by this object.
         std::string filename;
@@ -0,0 +1,13 @@
+#include "resources/resource_cache.hpp"
+#include <boost/filesystem.hpp>
+
+namespace scenegraphdemo {
+    std::string canonicalResourcePath(const std::string &path) {
+        boost::system::error_code error;
+        boost::filesystem::path canonical = boost::filesystem::canonical(path, error);
+        if (error) {
+            return boost::filesystem::absolute(path).lexically_normal().string();
+        }
+        return canonical.string();
+    }
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace scenegraphdemo {
+    // Returns the canonical form of a path used as a cache key, so different
+    // spellings of the same file share an entry. Paths that can't be
+    // resolved, such as missing files or files that only exist in a mounted
+    // asset archive, fall back to their normalized absolute form.
+    std::string canonicalResourcePath(const std::string &path);
+
+    // Counters describing how a resource cache has been used.
+    struct ResourceCacheStats {
+        // Number of requests served from the cache, including requests that
+        // waited on a load already in progress.
+        std::size_t hits = 0;
+
+        // Number of requests that had to load the resource.
+        std::size_t misses = 0;
+
+        // Number of entries evicted to stay within the memory budget.
+        std::size_t evictions = 0;
+
+        // Number of entries and their combined size as of the last trim.
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+    };
+
+    // Cache of resources of type T keyed by canonical path. Callers receive
+    // shared handles, so every request for the same file gets the same
+    // object, and a file requested by several threads at once is only loaded
+    // by the first of them while the others wait for it. Once the cache holds
+    // more than its memory budget, entries no one else holds a handle to are
+    // evicted, least recently used first.
+    template <typename T>
+    class ResourceCache {
+    public:
+        // Loads a resource from a canonical path. Exceptions thrown here are
+        // passed on to every caller waiting on the load, and nothing is
+        // cached.
+        using Loader = std::function<std::shared_ptr<T>(const std::string &path)>;
+
+        // Returns the number of bytes a resource currently occupies. Sizes are
+        // queried whenever the cache trims, so resources that grow after
+        // loading, like asynchronously loaded images, are accounted for.
+        using Sizer = std::function<std::size_t(const T &resource)>;
+
+        // Default memory budget.
+        static constexpr std::size_t DEFAULT_BUDGET = 256 * 1024 * 1024;
+
+        ResourceCache(Loader loader, Sizer sizer, std::size_t budget = DEFAULT_BUDGET) :
+            loader(std::move(loader)), sizer(std::move(sizer)), budget(budget) {}
+
+        ResourceCache(const ResourceCache &) = delete;
+        ResourceCache &operator=(const ResourceCache &) = delete;
+
+        // Returns the resource for a path, loading it if it isn't cached.
+        std::shared_ptr<T> get(const std::string &path) {
+            const std::string key = canonicalResourcePath(path);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (it != entries.end()) {
+                stats.hits++;
+                it->second.lastUse = ++clock;
+                std::shared_future<std::shared_ptr<T>> value = it->second.value;
+                lock.unlock();
+                return value.get();
+            }
+
+            stats.misses++;
+            std::promise<std::shared_ptr<T>> promise;
+            entries.emplace(key, Entry{promise.get_future().share(), ++clock});
+            lock.unlock();
+
+            std::shared_ptr<T> resource;
+            try {
+                resource = loader(key);
+            } catch (...) {
+                lock.lock();
+                entries.erase(key);
+                lock.unlock();
+                promise.set_exception(std::current_exception());
+                throw;
+            }
+            promise.set_value(resource);
+
+            lock.lock();
+            trimLocked();
+            return resource;
+        }
+
+        // Sets the memory budget and evicts unused entries to meet it.
+        void setBudget(std::size_t budget) {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->budget = budget;
+            trimLocked();
+        }
+
+        // Evicts unused entries until the cache fits its budget.
+        void trim() {
+            std::lock_guard<std::mutex> lock(mutex);
+            trimLocked();
+        }
+
+        // Evicts every entry no one else holds a handle to.
+        void evictUnused() {
+            std::lock_guard<std::mutex> lock(mutex);
+            const std::size_t previous = budget;
+            budget = 0;
+            trimLocked();
+            budget = previous;
+        }
+
+        // Returns the cache's counters.
+        ResourceCacheStats getStats() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return stats;
+        }
+    private:
+        struct Entry {
+            std::shared_future<std::shared_ptr<T>> value;
+            std::uint64_t lastUse;
+        };
+
+        Loader loader;
+        Sizer sizer;
+        std::size_t budget;
+
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+        std::uint64_t clock = 0;
+        ResourceCacheStats stats;
+
+        void trimLocked() {
+            // Entries still loading count as empty until they're ready. Only
+            // entries whose resource is held by nothing but the cache can be
+            // evicted.
+            std::size_t bytes = 0;
+            std::vector<std::pair<std::uint64_t, std::string>> candidates;
+            for (const auto &entry : entries) {
+                const auto &value = entry.second.value;
+                if (value.wait_for(std::chrono::seconds(0)) != std::future_status::ready ||
+                        !value.get()) {
+                    continue;
+                }
+                bytes += sizer(*value.get());
+                if (value.get().use_count() == 1) {
+                    candidates.emplace_back(entry.second.lastUse, entry.first);
+                }
+            }
+
+            if (bytes > budget) {
+                std::sort(candidates.begin(), candidates.end());
+                for (const auto &candidate : candidates) {
+                    if (bytes <= budget) {
+                        break;
+                    }
+                    auto it = entries.find(candidate.second);
+                    bytes -= sizer(*it->second.value.get());
+                    entries.erase(it);
+                    stats.evictions++;
+                }
+            }
+
+            stats.entries = entries.size();
+            stats.bytes = bytes;
+        }
+    };
+
+    template <typename T>
+    constexpr std::size_t ResourceCache<T>::DEFAULT_BUDGET;
+}
@@ -0,0 +1,183 @@
+#include "rendering/renderable.hpp"
+#include "resources/image_resource.hpp"
+#include "resources/texture_array.hpp"
+#include <GL/glew.h>
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
+namespace scenegraphdemo {
+    TextureArray::TextureArray(int width, int height, GLint format, int layerCount) {
+        this->width = width;
+        this->height = height;
+        this->format = format;
+        this->layerCount = layerCount;
+
+        glGenTextures(1, &this->texture);
+        this->bind();
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        // Every level has to be defined for the texture to be complete.
+        int levelWidth = width;
+        int levelHeight = height;
+        for (int level = 0; ; level++) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, levelWidth, levelHeight, layerCount, 0,
+                format, GL_UNSIGNED_BYTE, nullptr);
+            if (levelWidth == 1 && levelHeight == 1) {
+                break;
+            }
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        glGenBuffers(1, &this->pixelBuffer);
+    }
+
+    TextureArray::~TextureArray() {
+        glDeleteBuffers(1, &this->pixelBuffer);
+        glDeleteTextures(1, &this->texture);
+    }
+
+    void TextureArray::copyLayer(int layer, const ImageResource &image) {
+        if (image.getWidth() != this->width || image.getHeight() != this->height ||
+                image.getFormat() != this->format || layer < 0 || layer >= this->layerCount) {
+            throw std::runtime_error("Image doesn't fit the texture array layer");
+        }
+
+        // Read the image's texture into the pixel buffer and define the layer
+        // from that same buffer, so the pixels never leave video memory.
+        const std::size_t bytesPerPixel = this->format == GL_RGBA ? 4 : 3;
+        const std::size_t size = std::size_t(this->width) * this->height * bytesPerPixel;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, this->pixelBuffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_COPY);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, image.getTexture());
+        glGetTexImage(GL_TEXTURE_2D, 0, this->format, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->pixelBuffer);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, this->texture);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, this->width, this->height, 1,
+            this->format, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    void TextureArray::generateMipmaps() {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, this->texture);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    void TextureArray::bind(int texture) {
+        glActiveTexture(GL_TEXTURE0 + texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, this->texture);
+    }
+
+    unsigned int TextureArray::getTexture() const {
+        return this->texture;
+    }
+
+    int TextureArray::getWidth() const {
+        return this->width;
+    }
+
+    int TextureArray::getHeight() const {
+        return this->height;
+    }
+
+    GLint TextureArray::getFormat() const {
+        return this->format;
+    }
+
+    int TextureArray::getLayerCount() const {
+        return this->layerCount;
+    }
+
+    TextureArrayBuilder::TextureArrayBuilder() {
+        this->maxLayers = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &this->maxLayers);
+
+        // OpenGL 3.3 guarantees at least 256 layers.
+        this->maxLayers = std::max(this->maxLayers, 256);
+    }
+
+    void TextureArrayBuilder::add(std::shared_ptr<ImageResource> image) {
+        this->pending.push_back(std::move(image));
+    }
+
+    void TextureArrayBuilder::build() {
+        // Group the images by everything a layer has to share, in the order
+        // they were added.
+        typedef std::tuple<int, int, GLint> Shape;
+        std::map<Shape, std::vector<std::shared_ptr<ImageResource>>> groups;
+        for (auto &image : this->pending) {
+            if (this->layers.count(image->getFilename()) != 0) {
+                continue;
+            }
+            if (!image->isLoaded()) {
+                throw std::runtime_error("Cannot pack an image that isn't loaded into a texture array");
+            }
+            auto &group = groups[Shape(image->getWidth(), image->getHeight(), image->getFormat())];
+            auto samePath = [&image](const std::shared_ptr<ImageResource> &other) {
+                return other->getFilename() == image->getFilename();
+            };
+            if (std::find_if(group.begin(), group.end(), samePath) == group.end()) {
+                group.push_back(image);
+            }
+        }
+        this->pending.clear();
+
+        for (auto &entry : groups) {
+            const auto &images = entry.second;
+            for (std::size_t first = 0; first < images.size(); first += this->maxLayers) {
+                const std::size_t count = std::min<std::size_t>(images.size() - first, this->maxLayers);
+                std::unique_ptr<TextureArray> array(new TextureArray(
+                    std::get<0>(entry.first), std::get<1>(entry.first), std::get<2>(entry.first), count));
+                for (std::size_t layer = 0; layer < count; layer++) {
+                    const auto &image = images[first + layer];
+                    array->copyLayer(layer, *image);
+
+                    TextureLayer location;
+                    location.array = array.get();
+                    location.layer = layer;
+                    this->layers[image->getFilename()] = location;
+                }
+                array->generateMipmaps();
+                this->arrays.push_back(std::move(array));
+            }
+        }
+    }
+
+    TextureLayer TextureArrayBuilder::find(const ImageResource *image) const {
+        if (image == nullptr) {
+            return TextureLayer();
+        }
+        auto it = this->layers.find(image->getFilename());
+        return it != this->layers.end() ? it->second : TextureLayer();
+    }
+
+    bool TextureArrayBuilder::assign(Renderable &renderable) const {
+        const TextureLayer location = this->find(renderable.texture);
+        if (!location) {
+            return false;
+        }
+        renderable.texture = nullptr;
+        renderable.textureArray = location.array;
+        renderable.textureLayer = location.layer;
+        return true;
+    }
+
+    const std::vector<std::unique_ptr<TextureArray>> &TextureArrayBuilder::getArrays() const {
+        return this->arrays;
+    }
+}
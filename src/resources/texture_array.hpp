@@ -0,0 +1,115 @@
+#pragma once
+
+#include "GL/glew.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace scenegraphdemo {
+    class ImageResource;
+    struct Renderable;
+
+    // OpenGL GL_TEXTURE_2D_ARRAY whose layers all share one size and format.
+    // Shaders sample it with a sampler2DArray and pick the layer per
+    // instance, so objects using different layers are drawn without binding
+    // another texture.
+    class TextureArray {
+    public:
+        // Allocates a mip chain for every layer. The contents are undefined
+        // until layers are copied in.
+        TextureArray(int width, int height, GLint format, int layerCount);
+        ~TextureArray();
+
+        TextureArray(const TextureArray &) = delete;
+        TextureArray &operator=(const TextureArray &) = delete;
+
+        // Copies the largest level of an image's texture into a layer. The
+        // copy stays on the GPU, so it works for images whose pixels were
+        // released from system memory. The image must match the array's size
+        // and format. Call generateMipmaps once every layer is copied.
+        void copyLayer(int layer, const ImageResource &image);
+
+        // Rebuilds the smaller levels of every layer.
+        void generateMipmaps();
+
+        // Binds the array for use with OpenGL.
+        void bind(int texture = 0);
+
+        // Returns the OpenGL id of the texture.
+        unsigned int getTexture() const;
+
+        int getWidth() const;
+        int getHeight() const;
+        GLint getFormat() const;
+        int getLayerCount() const;
+    private:
+        unsigned int texture;
+        int width;
+        int height;
+        GLint format;
+        int layerCount;
+
+        // Pixel buffer object the layers are staged through.
+        unsigned int pixelBuffer;
+    };
+
+    // Layer of a texture array holding a packed image.
+    struct TextureLayer {
+        TextureArray *array = nullptr;
+        unsigned int layer = 0;
+
+        explicit operator bool() const {
+            return array != nullptr;
+        }
+    };
+
+    // Packs images into texture arrays. Images sharing a size and format go
+    // into the same array, split over several arrays if there are more of
+    // them than the driver allows layers.
+    class TextureArrayBuilder {
+    public:
+        TextureArrayBuilder();
+
+        TextureArrayBuilder(const TextureArrayBuilder &) = delete;
+        TextureArrayBuilder &operator=(const TextureArrayBuilder &) = delete;
+
+        // Queues an image for packing. Images are copied when build is called,
+        // so they must be loaded by then. Adding an image twice, or another
+        // image loaded from the same file, packs it once.
+        void add(std::shared_ptr<ImageResource> image);
+
+        // Creates the arrays and copies every queued image into its layer.
+        // Images that were already packed by an earlier build keep their
+        // layers. The builder lets go of the images afterwards, so once
+        // nothing else holds them their own textures can be freed. Throws a
+        // std::runtime_error if a queued image isn't loaded. Must be called
+        // on the OpenGL thread.
+        void build();
+
+        // Returns the layer holding the file an image was loaded from, or an
+        // empty layer if it hasn't been packed.
+        TextureLayer find(const ImageResource *image) const;
+
+        // Points a renderable at the layer holding its texture and clears its
+        // texture, so it no longer refers to the image. Returns false and
+        // leaves the renderable untouched if its texture isn't packed.
+        bool assign(Renderable &renderable) const;
+
+        // Returns every array built so far.
+        const std::vector<std::unique_ptr<TextureArray>> &getArrays() const;
+    private:
+        // Largest number of layers the driver supports in an array.
+        int maxLayers;
+
+        // Images waiting for the next build.
+        std::vector<std::shared_ptr<ImageResource>> pending;
+
+        std::vector<std::unique_ptr<TextureArray>> arrays;
+
+        // Layers keyed by the path of the image they were copied from, which
+        // stays meaningful after the image itself is gone.
+        std::unordered_map<std::string, TextureLayer> layers;
+    };
+}
@@ -0,0 +1,230 @@
+#include "SDL2/SDL_image.h"
+#include "resources/asset_archive.hpp"
+#include "resources/raw_resource.hpp"
+#include "resources/resource_cache.hpp"
+#include "resources/texture_cache.hpp"
+#include <GL/glew.h>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+namespace scenegraphdemo {
+    // Rounds an offset up to the alignment of container levels.
+    static std::uint64_t alignLevel(std::uint64_t offset) {
+        return (offset + TEXTURE_CONTAINER_ALIGNMENT - 1) / TEXTURE_CONTAINER_ALIGNMENT * TEXTURE_CONTAINER_ALIGNMENT;
+    }
+
+    TextureContainer::TextureContainer(const std::string &filename) :
+            file(filename, MappedFileAccess::SEQUENTIAL) {
+        const std::size_t fileSize = file.size();
+        if (fileSize < sizeof(header)) {
+            throw std::runtime_error("Texture container is truncated: " + filename);
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, TEXTURE_CONTAINER_MAGIC, sizeof(TEXTURE_CONTAINER_MAGIC)) != 0 ||
+                header.version != TEXTURE_CONTAINER_VERSION) {
+            throw std::runtime_error("Not a texture container of a supported version: " + filename);
+        }
+        if ((header.bytesPerPixel != 3 && header.bytesPerPixel != 4) || header.levelCount == 0 ||
+                header.levelCount > (fileSize - sizeof(header)) / sizeof(TextureLevel) ||
+                header.pixelsOffset > fileSize || header.pixelsSize > fileSize - header.pixelsOffset) {
+            throw std::runtime_error("Texture container is corrupt: " + filename);
+        }
+
+        levels.resize(header.levelCount);
+        std::memcpy(levels.data(), file.data() + sizeof(header), levels.size() * sizeof(TextureLevel));
+        for (const auto &level : levels) {
+            if (level.offset > header.pixelsSize || level.size > header.pixelsSize - level.offset ||
+                    level.size != std::uint64_t(level.width) * level.height * header.bytesPerPixel) {
+                throw std::runtime_error("Texture container level is corrupt: " + filename);
+            }
+        }
+    }
+
+    void TextureContainer::write(const std::string &filename, const SDL_Surface *surface,
+            std::uint64_t sourceHash) {
+        const std::uint32_t bytesPerPixel = surface->format->BytesPerPixel;
+        if (bytesPerPixel != 3 && bytesPerPixel != 4) {
+            throw std::runtime_error("Unsupported color format for image: " + filename);
+        }
+
+        // Lay out the chain down to a single texel.
+        std::vector<TextureLevel> levels;
+        std::uint32_t width = surface->w;
+        std::uint32_t height = surface->h;
+        std::uint64_t offset = 0;
+        while (true) {
+            TextureLevel level;
+            level.width = width;
+            level.height = height;
+            level.offset = offset;
+            level.size = std::uint64_t(width) * height * bytesPerPixel;
+            levels.push_back(level);
+            offset = alignLevel(offset + level.size);
+            if (width == 1 && height == 1) {
+                break;
+            }
+            width = std::max<std::uint32_t>(width / 2, 1);
+            height = std::max<std::uint32_t>(height / 2, 1);
+        }
+
+        // The first level drops the row padding of the surface, and every
+        // following one averages 2x2 blocks of the one before. Odd edges
+        // repeat their last row or column.
+        std::vector<unsigned char> pixels(offset, 0);
+        for (std::uint32_t y = 0; y < levels[0].height; y++) {
+            std::memcpy(pixels.data() + y * levels[0].width * bytesPerPixel,
+                static_cast<const unsigned char *>(surface->pixels) + y * surface->pitch,
+                levels[0].width * bytesPerPixel);
+        }
+        for (std::size_t i = 1; i < levels.size(); i++) {
+            const TextureLevel &source = levels[i - 1];
+            const TextureLevel &target = levels[i];
+            const unsigned char *from = pixels.data() + source.offset;
+            unsigned char *to = pixels.data() + target.offset;
+            for (std::uint32_t y = 0; y < target.height; y++) {
+                const std::uint32_t y0 = std::min(y * 2, source.height - 1);
+                const std::uint32_t y1 = std::min(y * 2 + 1, source.height - 1);
+                for (std::uint32_t x = 0; x < target.width; x++) {
+                    const std::uint32_t x0 = std::min(x * 2, source.width - 1);
+                    const std::uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+                    for (std::uint32_t c = 0; c < bytesPerPixel; c++) {
+                        const unsigned sum =
+                            from[(y0 * source.width + x0) * bytesPerPixel + c] +
+                            from[(y0 * source.width + x1) * bytesPerPixel + c] +
+                            from[(y1 * source.width + x0) * bytesPerPixel + c] +
+                            from[(y1 * source.width + x1) * bytesPerPixel + c];
+                        to[(y * target.width + x) * bytesPerPixel + c] = (sum + 2) / 4;
+                    }
+                }
+            }
+        }
+
+        TextureContainerHeader header = {};
+        std::memcpy(header.magic, TEXTURE_CONTAINER_MAGIC, sizeof(TEXTURE_CONTAINER_MAGIC));
+        header.version = TEXTURE_CONTAINER_VERSION;
+        header.bytesPerPixel = bytesPerPixel;
+        header.levelCount = levels.size();
+        header.sourceHash = sourceHash;
+        header.pixelsOffset = alignLevel(sizeof(header) + levels.size() * sizeof(TextureLevel));
+        header.pixelsSize = pixels.size();
+
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(levels.data()), levels.size() * sizeof(TextureLevel));
+        const std::size_t padding = header.pixelsOffset - sizeof(header) - levels.size() * sizeof(TextureLevel);
+        const char zeros[TEXTURE_CONTAINER_ALIGNMENT] = {};
+        out.write(zeros, padding);
+        out.write(reinterpret_cast<const char *>(pixels.data()), pixels.size());
+        if (!out) {
+            throw std::runtime_error("Cannot write texture container: " + filename);
+        }
+    }
+
+    std::uint64_t TextureContainer::getSourceHash() const {
+        return header.sourceHash;
+    }
+
+    GLint TextureContainer::getFormat() const {
+        return header.bytesPerPixel == 4 ? GL_RGBA : GL_RGB;
+    }
+
+    const std::vector<TextureLevel> &TextureContainer::getLevels() const {
+        return levels;
+    }
+
+    const char *TextureContainer::getPixels() const {
+        return file.data() + header.pixelsOffset;
+    }
+
+    std::size_t TextureContainer::getPixelsSize() const {
+        return header.pixelsSize;
+    }
+
+    void TextureContainer::upload(const char *pixels) const {
+        const GLint format = getFormat();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels.size() - 1);
+        for (std::size_t i = 0; i < levels.size(); i++) {
+            const TextureLevel &level = levels[i];
+
+            // With a pixel unpack buffer bound, the pointer is an offset into
+            // the buffer.
+            const void *data = pixels != nullptr ?
+                static_cast<const void *>(pixels + level.offset) :
+                reinterpret_cast<const void *>(static_cast<std::uintptr_t>(level.offset));
+            glTexImage2D(GL_TEXTURE_2D, i, format, level.width, level.height, 0,
+                format, GL_UNSIGNED_BYTE, data);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    TextureCache::TextureCache(const std::string &directory) {
+        this->directory = directory;
+        boost::filesystem::create_directories(directory);
+    }
+
+    // Cache used when images are loaded. Accessed atomically since textures
+    // may be loaded on worker threads.
+    static std::shared_ptr<TextureCache> defaultCache;
+
+    std::shared_ptr<TextureCache> TextureCache::getDefault() {
+        return std::atomic_load(&defaultCache);
+    }
+
+    void TextureCache::setDefault(std::shared_ptr<TextureCache> cache) {
+        std::atomic_store(&defaultCache, cache);
+    }
+
+    std::unique_ptr<TextureContainer> TextureCache::load(const std::string &sourceFilename) {
+        // Hashing the source is much cheaper than decoding it, and catches
+        // edits that keep the file's size and modification time.
+        RawResource source(sourceFilename, RawResourceMode::MAP);
+        const std::uint64_t sourceHash = hashBytes(source.data(), source.size());
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.sgdtex",
+            static_cast<unsigned long long>(hashAssetPath(canonicalResourcePath(sourceFilename))));
+        const std::string filename = (boost::filesystem::path(directory) / name).string();
+
+        if (boost::filesystem::exists(filename)) {
+            try {
+                std::unique_ptr<TextureContainer> container(new TextureContainer(filename));
+                if (container->getSourceHash() == sourceHash) {
+                    return container;
+                }
+            } catch (const std::runtime_error &) {
+                // Corrupt or outdated containers are rebuilt below.
+            }
+        }
+
+        SDL_Surface *surface = IMG_Load_RW(SDL_RWFromConstMem(source.data(), source.size()), 1);
+        if (!surface) {
+            throw std::runtime_error("Unable to load image: " + sourceFilename);
+        }
+
+        // Write to a file of this thread's own and move it into place, so
+        // readers never see a partial container even if the same image is
+        // converted twice at once.
+        const std::string temporary = filename + "." +
+            std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+        try {
+            TextureContainer::write(temporary, surface, sourceHash);
+        } catch (...) {
+            SDL_FreeSurface(surface);
+            boost::system::error_code error;
+            boost::filesystem::remove(temporary, error);
+            throw;
+        }
+        SDL_FreeSurface(surface);
+        boost::filesystem::rename(temporary, filename);
+        return std::unique_ptr<TextureContainer>(new TextureContainer(filename));
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "SDL2/SDL.h"
+#include "resources/mapped_file.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace scenegraphdemo {
+    // Texture containers hold an image's full mip chain, decoded and laid out
+    // the way glTexImage2D expects it: tightly packed rows of 8-bit RGB or
+    // RGBA texels, level by level, each level starting at a
+    // TEXTURE_CONTAINER_ALIGNMENT byte boundary of the pixel data.
+    const char TEXTURE_CONTAINER_MAGIC[8] = {'S', 'G', 'D', 'T', 'E', 'X', '\0', '\0'};
+    const std::uint32_t TEXTURE_CONTAINER_VERSION = 1;
+    const std::size_t TEXTURE_CONTAINER_ALIGNMENT = 16;
+
+    struct TextureContainerHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t bytesPerPixel;
+        std::uint32_t levelCount;
+        std::uint32_t reserved;
+
+        // Hash of the source image file the container was converted from.
+        std::uint64_t sourceHash;
+
+        // Location and size of the pixel data of every level.
+        std::uint64_t pixelsOffset;
+        std::uint64_t pixelsSize;
+    };
+
+    struct TextureLevel {
+        std::uint32_t width;
+        std::uint32_t height;
+
+        // Location of the level relative to the start of the pixel data.
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    static_assert(sizeof(TextureContainerHeader) == 48, "Texture container header layout changed");
+    static_assert(sizeof(TextureLevel) == 24, "Texture level layout changed");
+
+    // Memory-mapped texture container.
+    class TextureContainer {
+    public:
+        // Opens a container. Throws a std::runtime_error if the file can't be
+        // mapped or isn't a valid container.
+        TextureContainer(const std::string &filename);
+
+        TextureContainer(const TextureContainer &) = delete;
+        TextureContainer &operator=(const TextureContainer &) = delete;
+
+        // Converts a decoded image into a container file holding its full mip
+        // chain, which is built with a box filter. Throws a
+        // std::runtime_error if the image format isn't supported or the file
+        // can't be written.
+        static void write(const std::string &filename, const SDL_Surface *surface, std::uint64_t sourceHash);
+
+        // Returns the hash of the image the container was converted from.
+        std::uint64_t getSourceHash() const;
+
+        // Returns the OpenGL format of the texels, GL_RGB or GL_RGBA.
+        GLint getFormat() const;
+
+        // Returns the mip levels, largest first.
+        const std::vector<TextureLevel> &getLevels() const;
+
+        // Returns the pixel data of every level, which level offsets are
+        // relative to.
+        const char *getPixels() const;
+        std::size_t getPixelsSize() const;
+
+        // Defines every level of the texture bound to GL_TEXTURE_2D. Passing
+        // nullptr reads the pixel data from the bound pixel unpack buffer
+        // instead, which must hold a copy of getPixels().
+        void upload(const char *pixels) const;
+    private:
+        MappedFile file;
+        TextureContainerHeader header;
+        std::vector<TextureLevel> levels;
+    };
+
+    // Directory of texture containers converted from source images, so images
+    // are decoded and their mip chains built once instead of on every run.
+    // Containers are named after the source's path and remember a hash of
+    // the source's contents, so they're rebuilt when the source changes.
+    class TextureCache {
+    public:
+        // Uses a directory to store containers, creating it if needed.
+        TextureCache(const std::string &directory);
+
+        TextureCache(const TextureCache &) = delete;
+        TextureCache &operator=(const TextureCache &) = delete;
+
+        // Returns the cache used by ImageResource and TextureLoader, or
+        // nullptr if images are decoded every time.
+        static std::shared_ptr<TextureCache> getDefault();
+
+        // Sets the cache used by ImageResource and TextureLoader.
+        static void setDefault(std::shared_ptr<TextureCache> cache);
+
+        // Returns the container for a source image, converting the image
+        // first if there's no container for it yet or it's stale. Throws a
+        // std::runtime_error if the source can't be read or decoded, or the
+        // container can't be written. Safe to call from any thread.
+        std::unique_ptr<TextureContainer> load(const std::string &sourceFilename);
+    private:
+        std::string directory;
+    };
+}
@@ -0,0 +1,219 @@
+#include "logging.hpp"
+#include "resources/texture_cache.hpp"
+#include "resources/texture_loader.hpp"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace scenegraphdemo {
+    constexpr std::size_t TextureLoader::DEFAULT_UPLOAD_BUDGET;
+
+    TextureLoader::TextureLoader(ThreadPool &pool, std::size_t uploadBudget) : pool(pool) {
+        this->uploadBudget = uploadBudget;
+        glGenBuffers(1, &this->pixelBuffer);
+    }
+
+    TextureLoader::~TextureLoader() {
+        // Decode errors are reported through their requests, so anything
+        // left here escaped decode and only needs reporting.
+        try {
+            pool.wait(decodes);
+        } catch (const std::exception &e) {
+            scenegraphdemo::error("Texture decode failed: ", e.what());
+        }
+        for (auto &request : decoded) {
+            SDL_FreeSurface(request->surface);
+        }
+        for (auto &request : uploads) {
+            SDL_FreeSurface(request->surface);
+        }
+        glDeleteBuffers(1, &this->pixelBuffer);
+    }
+
+    std::shared_ptr<ImageResource> TextureLoader::load(std::string filename, ImageResidency residency) {
+        std::unique_ptr<Request> request(new Request());
+        request->image = ImageResource::createPlaceholder(filename, residency);
+        request->filename = filename;
+        std::shared_ptr<ImageResource> image = request->image;
+        stats.requested++;
+
+        // std::function must be copyable, so the request travels as a raw
+        // pointer and is owned again once decoded.
+        Request *pending = request.release();
+        pool.submit(decodes, [this, pending] {
+            decode(pending);
+        });
+        return image;
+    }
+
+    void TextureLoader::update() {
+        const auto begin = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto &request : decoded) {
+                stats.loadTime += request->loadTime;
+                if (request->container) {
+                    stats.cached++;
+                }
+                uploads.push_back(std::move(request));
+            }
+            decoded.clear();
+        }
+
+        stats.frameBytes = 0;
+        stats.frameUploads = 0;
+        while (!uploads.empty()) {
+            Request &request = *uploads.front();
+            if (!request.warning.empty()) {
+                scenegraphdemo::warn("Texture cache unavailable: ", request.warning);
+                request.warning.clear();
+            }
+            if (request.surface == nullptr && !request.container) {
+                scenegraphdemo::error("Unable to load image ", request.filename, ": ", request.error);
+                stats.failed++;
+                uploads.pop_front();
+                continue;
+            }
+
+            // Always make progress on at least one image per update.
+            const std::size_t size = request.container ?
+                request.container->getPixelsSize() :
+                request.surface->pitch * request.surface->h;
+            if (stats.frameUploads > 0 && stats.frameBytes + size > uploadBudget) {
+                break;
+            }
+            if (request.container) {
+                uploadContainer(request);
+            } else {
+                upload(request);
+            }
+            stats.frameBytes += size;
+            stats.frameUploads++;
+            stats.uploaded++;
+            uploads.pop_front();
+        }
+        stats.pendingUploads = uploads.size();
+
+        const double elapsed = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - begin).count();
+        stats.uploadTime += elapsed;
+        stats.maximumUpdateTime = std::max(stats.maximumUpdateTime, elapsed);
+    }
+
+    bool TextureLoader::idle() const {
+        return stats.uploaded + stats.failed == stats.requested;
+    }
+
+    TextureLoaderStats TextureLoader::getStats() const {
+        return stats;
+    }
+
+    void TextureLoader::decode(Request *pending) {
+        std::unique_ptr<Request> request(pending);
+        const auto begin = std::chrono::steady_clock::now();
+        std::shared_ptr<TextureCache> cache = TextureCache::getDefault();
+        if (cache) {
+            try {
+                request->container = cache->load(request->filename);
+                request->format = request->container->getFormat();
+            } catch (const std::runtime_error &e) {
+                request->warning = e.what();
+            }
+        }
+
+        if (!request->container) {
+            SDL_Surface *surface = nullptr;
+            try {
+                surface = ImageResource::loadSurface(request->filename);
+                if (!surface) {
+                    request->error = SDL_GetError();
+                } else {
+                    request->format = ImageResource::formatOf(surface, request->filename);
+                    request->surface = surface;
+                }
+            } catch (const std::runtime_error &e) {
+                request->error = e.what();
+                SDL_FreeSurface(surface);
+            }
+        }
+
+        request->loadTime = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - begin).count();
+        std::lock_guard<std::mutex> lock(mutex);
+        decoded.push_back(std::move(request));
+    }
+
+    void TextureLoader::upload(Request &request) {
+        SDL_Surface *surface = request.surface;
+        const std::size_t size = surface->pitch * surface->h;
+
+        // Orphan the previous upload's storage and copy the pixels into fresh
+        // storage, which the driver can transfer to the texture on its own
+        // schedule. Fall back to uploading from client memory if mapping
+        // fails.
+        const void *pixels = surface->pixels;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        void *staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (staging != nullptr) {
+            std::memcpy(staging, surface->pixels, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            pixels = nullptr;
+        } else {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+
+        // Rows of SDL surfaces may be padded, so the row length is given
+        // explicitly.
+        ImageResource &image = *request.image;
+        image.bind();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, surface->pitch / surface->format->BytesPerPixel);
+        glTexImage2D(GL_TEXTURE_2D, 0, request.format, surface->w, surface->h, 0,
+            request.format, GL_UNSIGNED_BYTE, pixels);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        image.surface = surface;
+        image.format = request.format;
+        image.finishUpload(surface->w, surface->h);
+        request.surface = nullptr;
+    }
+
+    void TextureLoader::uploadContainer(Request &request) {
+        const TextureContainer &container = *request.container;
+        const std::size_t size = container.getPixelsSize();
+
+        // Same staging as upload, but the container already holds every mip
+        // level, so nothing is generated on the GPU.
+        const char *pixels = container.getPixels();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        void *staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (staging != nullptr) {
+            std::memcpy(staging, pixels, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            pixels = nullptr;
+        } else {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+
+        ImageResource &image = *request.image;
+        image.bind();
+        container.upload(pixels);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        const TextureLevel &level = container.getLevels().front();
+        image.format = request.format;
+        image.container = std::move(request.container);
+        image.finishUpload(level.width, level.height);
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "resources/image_resource.hpp"
+#include "threading/thread_pool.hpp"
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace scenegraphdemo {
+    // Counters describing the progress of a texture loader.
+    struct TextureLoaderStats {
+        // Number of images requested so far.
+        std::size_t requested = 0;
+
+        // Number of images whose pixel data reached their texture.
+        std::size_t uploaded = 0;
+
+        // Number of images that failed to decode and kept their placeholder.
+        std::size_t failed = 0;
+
+        // Number of images read from texture cache containers, which were
+        // either already cached or converted on the spot.
+        std::size_t cached = 0;
+
+        // Milliseconds workers spent reading the images handed over so far,
+        // from the texture cache or by decoding them.
+        double loadTime = 0.0;
+
+        // Number of decoded images waiting for upload.
+        std::size_t pendingUploads = 0;
+
+        // Bytes uploaded and images completed by the last update.
+        std::size_t frameBytes = 0;
+        std::size_t frameUploads = 0;
+
+        // Milliseconds spent uploading across all updates, and in the
+        // longest single update, which is the worst hitch loading caused.
+        double uploadTime = 0.0;
+        double maximumUpdateTime = 0.0;
+    };
+
+    // Loads images without stalling the OpenGL thread. Files are decoded on a
+    // thread pool, and the decoded pixels are streamed into textures through
+    // a pixel buffer object a few at a time, so a burst of loads is spread
+    // over several frames instead of landing in one.
+    class TextureLoader {
+    public:
+        // Default number of bytes uploaded per update.
+        static constexpr std::size_t DEFAULT_UPLOAD_BUDGET = 8 * 1024 * 1024;
+
+        // Decodes on the given pool and uploads up to uploadBudget bytes per
+        // update. An image larger than the budget is still uploaded on its
+        // own so it can't block the queue.
+        TextureLoader(ThreadPool &pool, std::size_t uploadBudget = DEFAULT_UPLOAD_BUDGET);
+
+        // Waits for outstanding decodes. Images that didn't get their pixel
+        // data keep showing the placeholder.
+        ~TextureLoader();
+
+        TextureLoader(const TextureLoader &) = delete;
+        TextureLoader &operator=(const TextureLoader &) = delete;
+
+        // Returns an image that can be bound right away. It shows a single
+        // white texel until its pixel data has been decoded and uploaded,
+        // after which the residency policy decides whether the pixels stay in
+        // memory. Must be called on the OpenGL thread.
+        std::shared_ptr<ImageResource> load(std::string filename,
+            ImageResidency residency = ImageResidency::KEEP);
+
+        // Uploads decoded images within the per-frame budget. Must be called
+        // once per frame on the OpenGL thread.
+        void update();
+
+        // Returns whether every requested image was uploaded or failed.
+        bool idle() const;
+
+        // Returns the loader's counters.
+        TextureLoaderStats getStats() const;
+    private:
+        // An image travelling from a worker thread to the OpenGL thread.
+        struct Request {
+            std::shared_ptr<ImageResource> image;
+            std::string filename;
+            SDL_Surface *surface = nullptr;
+            std::unique_ptr<TextureContainer> container;
+            GLint format = 0;
+
+            // Set when the texture cache couldn't be used.
+            std::string warning;
+            std::string error;
+
+            // Milliseconds the worker spent reading the image.
+            double loadTime = 0.0;
+        };
+
+        ThreadPool &pool;
+        TaskGroup decodes;
+        std::size_t uploadBudget;
+
+        // Pixel buffer object staging uploads.
+        unsigned int pixelBuffer;
+
+        // Requests finished by workers, guarded by mutex.
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<Request>> decoded;
+
+        // Decoded requests owned by the OpenGL thread, oldest first.
+        std::deque<std::unique_ptr<Request>> uploads;
+
+        TextureLoaderStats stats;
+
+        // Decodes a request's file, or maps its texture container when a
+        // texture cache is in use, and hands it back to the OpenGL thread.
+        // Runs on a worker thread.
+        void decode(Request *request);
+
+        // Copies a request's pixels into the pixel buffer and from there into
+        // its texture.
+        void upload(Request &request);
+
+        // Same as upload, for requests that have a texture container.
+        void uploadContainer(Request &request);
+    };
+}
@@ -0,0 +1,148 @@
+#include "logging.hpp"
+#include "resources/asset_archive.hpp"
+#include "shaders/program_binary_cache.hpp"
+#include <GL/glew.h>
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace scenegraphdemo {
+    // Returns an OpenGL string, or an empty string if the driver has none.
+    static std::string glString(GLenum name) {
+        const GLubyte *value = glGetString(name);
+        return value != nullptr ? reinterpret_cast<const char *>(value) : "";
+    }
+
+    ProgramBinaryCache::ProgramBinaryCache(const std::string &directory) {
+        this->directory = directory;
+        boost::filesystem::create_directories(directory);
+
+        this->driver = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        this->supported = formats > 0;
+    }
+
+    // Cache used when shaders are created.
+    static std::shared_ptr<ProgramBinaryCache> defaultCache;
+
+    std::shared_ptr<ProgramBinaryCache> ProgramBinaryCache::getDefault() {
+        return defaultCache;
+    }
+
+    void ProgramBinaryCache::setDefault(std::shared_ptr<ProgramBinaryCache> cache) {
+        defaultCache = cache;
+    }
+
+    bool ProgramBinaryCache::isSupported() const {
+        return this->supported;
+    }
+
+    unsigned int ProgramBinaryCache::load(const char *vertexShaderSource, const char *fragmentShaderSource) {
+        if (!this->supported) {
+            return 0;
+        }
+
+        const std::uint64_t key = this->keyOf(vertexShaderSource, fragmentShaderSource);
+        const std::string filename = this->pathOf(key);
+        boost::system::error_code error;
+        const std::uintmax_t fileSize = boost::filesystem::file_size(filename, error);
+        std::ifstream file(filename, std::ios::binary);
+        ProgramBinaryHeader header;
+        if (error || !file.is_open() || !file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+                std::memcmp(header.magic, PROGRAM_BINARY_MAGIC, sizeof(PROGRAM_BINARY_MAGIC)) != 0 ||
+                header.version != PROGRAM_BINARY_VERSION || header.key != key ||
+                header.binarySize != fileSize - sizeof(header)) {
+            this->stats.misses++;
+            return 0;
+        }
+
+        std::vector<char> binary(header.binarySize);
+        if (!file.read(binary.data(), binary.size())) {
+            this->stats.misses++;
+            return 0;
+        }
+
+        // The driver checks the binary itself and fails the link status if it
+        // won't take it.
+        unsigned int program = glCreateProgram();
+        glProgramBinary(program, header.binaryFormat, binary.data(), binary.size());
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glDeleteProgram(program);
+            this->stats.rejected++;
+            return 0;
+        }
+
+        this->stats.hits++;
+        return program;
+    }
+
+    void ProgramBinaryCache::store(unsigned int program, const char *vertexShaderSource,
+            const char *fragmentShaderSource) {
+        if (!this->supported) {
+            return;
+        }
+
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+        std::vector<char> binary(length);
+        GLenum binaryFormat = 0;
+        glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+
+        ProgramBinaryHeader header = {};
+        std::memcpy(header.magic, PROGRAM_BINARY_MAGIC, sizeof(PROGRAM_BINARY_MAGIC));
+        header.version = PROGRAM_BINARY_VERSION;
+        header.binaryFormat = binaryFormat;
+        header.key = this->keyOf(vertexShaderSource, fragmentShaderSource);
+        header.binarySize = length;
+
+        // Write next to the final file and move it into place, so an
+        // interrupted write can't leave a truncated binary behind.
+        const std::string filename = this->pathOf(header.key);
+        const std::string temporary = filename + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(binary.data(), length);
+            if (!file) {
+                scenegraphdemo::warn("Cannot write program binary: ", temporary);
+                return;
+            }
+        }
+        boost::system::error_code error;
+        boost::filesystem::rename(temporary, filename, error);
+        if (error) {
+            scenegraphdemo::warn("Cannot write program binary ", filename, ": ", error.message());
+            boost::filesystem::remove(temporary, error);
+            return;
+        }
+        this->stats.stored++;
+    }
+
+    ProgramBinaryCacheStats ProgramBinaryCache::getStats() const {
+        return this->stats;
+    }
+
+    std::uint64_t ProgramBinaryCache::keyOf(const char *vertexShaderSource,
+            const char *fragmentShaderSource) const {
+        std::string key = vertexShaderSource;
+        key += '\0';
+        key += fragmentShaderSource;
+        key += '\0';
+        key += this->driver;
+        return hashBytes(key.data(), key.size());
+    }
+
+    std::string ProgramBinaryCache::pathOf(std::uint64_t key) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.sgdprog", static_cast<unsigned long long>(key));
+        return (boost::filesystem::path(this->directory) / name).string();
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace scenegraphdemo {
+    // Cached programs are stored as a header followed by the binary returned
+    // by glGetProgramBinary.
+    const char PROGRAM_BINARY_MAGIC[8] = {'S', 'G', 'D', 'P', 'R', 'O', 'G', '\0'};
+    const std::uint32_t PROGRAM_BINARY_VERSION = 1;
+
+    struct ProgramBinaryHeader {
+        char magic[8];
+        std::uint32_t version;
+
+        // Driver-specific format of the binary.
+        std::uint32_t binaryFormat;
+
+        // Key the binary was stored under, see ProgramBinaryCache.
+        std::uint64_t key;
+        std::uint64_t binarySize;
+    };
+
+    static_assert(sizeof(ProgramBinaryHeader) == 32, "Program binary header layout changed");
+
+    // Counters describing how well a program binary cache performs.
+    struct ProgramBinaryCacheStats {
+        // Programs created from a cached binary.
+        std::size_t hits = 0;
+
+        // Programs that had no cached binary.
+        std::size_t misses = 0;
+
+        // Cached binaries the driver refused, usually after a driver update
+        // that kept its version string.
+        std::size_t rejected = 0;
+
+        // Binaries written to the cache.
+        std::size_t stored = 0;
+    };
+
+    // Directory of linked shader programs, so programs are compiled from
+    // source once instead of on every run. Binaries are keyed by a hash of
+    // the shader sources together with the vendor, renderer and version of
+    // the OpenGL driver, since drivers only accept binaries they produced
+    // themselves. All functions must be called on the OpenGL thread.
+    class ProgramBinaryCache {
+    public:
+        // Uses a directory to store binaries, creating it if needed.
+        ProgramBinaryCache(const std::string &directory);
+
+        ProgramBinaryCache(const ProgramBinaryCache &) = delete;
+        ProgramBinaryCache &operator=(const ProgramBinaryCache &) = delete;
+
+        // Returns the cache used by Shader, or nullptr if programs are always
+        // compiled from source.
+        static std::shared_ptr<ProgramBinaryCache> getDefault();
+
+        // Sets the cache used by Shader.
+        static void setDefault(std::shared_ptr<ProgramBinaryCache> cache);
+
+        // Returns whether the driver supports any program binary format. The
+        // cache does nothing when it doesn't.
+        bool isSupported() const;
+
+        // Creates a linked program from the cached binary for a pair of
+        // shader sources. Returns 0 if there's no usable binary, in which case
+        // the program has to be compiled from source.
+        unsigned int load(const char *vertexShaderSource, const char *fragmentShaderSource);
+
+        // Stores the binary of a program linked from a pair of shader sources.
+        // The program should have been linked with
+        // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set. Failing to write the binary
+        // only costs a compile on the next run, so it's logged rather than
+        // thrown.
+        void store(unsigned int program, const char *vertexShaderSource, const char *fragmentShaderSource);
+
+        // Returns the cache's counters.
+        ProgramBinaryCacheStats getStats() const;
+    private:
+        std::string directory;
+
+        // Vendor, renderer and version strings of the driver, joined.
+        std::string driver;
+
+        bool supported;
+
+        ProgramBinaryCacheStats stats;
+
+        // Hashes a pair of shader sources together with the driver strings.
+        std::uint64_t keyOf(const char *vertexShaderSource, const char *fragmentShaderSource) const;
+
+        // Returns the path of the binary stored under a key.
+        std::string pathOf(std::uint64_t key) const;
+    };
+}
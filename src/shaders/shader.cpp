@@ -1,29 +1,139 @@
+#include "shaders/program_binary_cache.hpp"
 #include "shaders/shader.hpp"
 #include <GL/glew.h>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <iostream>
+#include <utility>
 
 namespace scenegraphdemo {
     const size_t SHADER_LOG_SIZE = 512;
 
+    unsigned int Shader::currentProgram = 0;
+
     Shader::Shader(const char *vertexShaderSource, const char *fragmentShaderSource) {
-        this->program = this->linkProgram(
-            this->createShader(vertexShaderSource, GL_VERTEX_SHADER),
-            this->createShader(fragmentShaderSource, GL_FRAGMENT_SHADER));
+        std::shared_ptr<ProgramBinaryCache> cache = ProgramBinaryCache::getDefault();
+        this->program = cache ? cache->load(vertexShaderSource, fragmentShaderSource) : 0;
+        if (this->program == 0) {
+            this->program = this->linkProgram(
+                this->createShader(vertexShaderSource, GL_VERTEX_SHADER),
+                this->createShader(fragmentShaderSource, GL_FRAGMENT_SHADER),
+                cache && cache->isSupported());
+            if (cache) {
+                cache->store(this->program, vertexShaderSource, fragmentShaderSource);
+            }
+        }
+        this->introspectUniforms();
     }
 
     void Shader::use() {
         glUseProgram(this->program);
+        currentProgram = this->program;
+    }
+
+    unsigned int Shader::getProgram() const {
+        return this->program;
+    }
+
+    UniformHandle Shader::getUniform(const char *uniform) const {
+        UniformHandle handle;
+        auto it = this->uniformIndices.find(uniform);
+        if (it != this->uniformIndices.end()) {
+            handle.index = it->second;
+        }
+        return handle;
+    }
+
+    void Shader::setUniformInt(UniformHandle uniform, int value) {
+        if (!uniform.valid()) {
+            return;
+        }
+        Uniform &entry = this->uniforms[uniform.index];
+        if (entry.cached && entry.intValue == value) {
+            this->skippedUniformUploads++;
+            return;
+        }
+
+        this->ensureCurrent();
+        glUniform1i(entry.location, value);
+        entry.intValue = value;
+        entry.cached = true;
+        this->uniformUploads++;
     }
 
     void Shader::setUniformInt(const char *uniform, int value) {
-        GLint location = glGetUniformLocation(this->program, uniform);
-        glUniform1i(location, value);
+        this->setUniformInt(this->getUniform(uniform), value);
+    }
+
+    void Shader::setUniformMat4(UniformHandle uniform, const float *value) {
+        if (!uniform.valid()) {
+            return;
+        }
+        Uniform &entry = this->uniforms[uniform.index];
+        if (entry.cached && std::memcmp(entry.floatValues, value, sizeof(entry.floatValues)) == 0) {
+            this->skippedUniformUploads++;
+            return;
+        }
+
+        this->ensureCurrent();
+        glUniformMatrix4fv(entry.location, 1, GL_FALSE, value);
+        std::memcpy(entry.floatValues, value, sizeof(entry.floatValues));
+        entry.cached = true;
+        this->uniformUploads++;
+    }
+
+    void Shader::setUniformMat4(const char *uniform, const float *value) {
+        this->setUniformMat4(this->getUniform(uniform), value);
+    }
+
+    std::size_t Shader::getUniformUploads() const {
+        return this->uniformUploads;
+    }
+
+    std::size_t Shader::getSkippedUniformUploads() const {
+        return this->skippedUniformUploads;
+    }
+
+    void Shader::introspectUniforms() {
+        GLint count = 0;
+        GLint maxNameLength = 0;
+        glGetProgramiv(this->program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(this->program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+        std::vector<char> name(maxNameLength + 1);
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(this->program, i, name.size(), &length, &size, &type, name.data());
+
+            Uniform uniform;
+            uniform.name.assign(name.data(), length);
+            uniform.location = glGetUniformLocation(this->program, uniform.name.c_str());
+            uniform.type = type;
+
+            // Uniforms in blocks have no location and can't be set directly.
+            if (uniform.location < 0) {
+                continue;
+            }
+
+            // Arrays are reported by the name of their first element, but
+            // should also be found by their plain name.
+            const std::string arraySuffix = "[0]";
+            const auto suffixStart = uniform.name.size() >= arraySuffix.size() ?
+                uniform.name.size() - arraySuffix.size() : 0;
+            if (uniform.name.compare(suffixStart, std::string::npos, arraySuffix) == 0) {
+                this->uniformIndices.emplace(uniform.name.substr(0, suffixStart), this->uniforms.size());
+            }
+            this->uniformIndices.emplace(uniform.name, this->uniforms.size());
+            this->uniforms.push_back(std::move(uniform));
+        }
     }
 
-    void Shader::setUniformMat4(const char *uniform, float *value) {
-        GLint location = glGetUniformLocation(this->program, uniform);
-        glUniformMatrix4fv(location, 1, GL_FALSE, value);
+    void Shader::ensureCurrent() {
+        if (currentProgram != this->program) {
+            this->use();
+        }
     }
 
     unsigned int Shader::createShader(const char *source, unsigned int type) {
@@ -44,8 +154,12 @@ namespace scenegraphdemo {
         return shader;
     }
 
-    unsigned int Shader::linkProgram(unsigned int vertexShader, unsigned int fragmentShader) {
+    unsigned int Shader::linkProgram(unsigned int vertexShader, unsigned int fragmentShader,
+            bool retrievable) {
         unsigned int program = glCreateProgram();
+        if (retrievable) {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
         glAttachShader(program, vertexShader);
         glAttachShader(program, fragmentShader);
         glLinkProgram(program);
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <glm/glm.hpp>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace scenegraphdemo {
     struct ShaderCompilationError : public std::exception {
@@ -16,26 +19,90 @@ namespace scenegraphdemo {
         }
     };
 
+    // Pre-resolved reference to an active uniform of a shader program. Handles
+    // are only meaningful for the shader that returned them.
+    struct UniformHandle {
+        int index = -1;
+
+        // Returns whether the handle refers to an active uniform.
+        bool valid() const {
+            return index >= 0;
+        }
+    };
+
     // Wrapper around an OpenGL shader program with utility functions for
     // compilation, linking and usage of the shader program.
     class Shader {
     public:
-        // TODO: Implemente a resource manager and switch the types.
+        // Builds a program from the sources of its two stages, which are
+        // usually the contents of RawResources requested through a
+        // ResourceCache. The program is created from a cached binary when the
+        // default ProgramBinaryCache has one for these sources, and compiled
+        // from source otherwise.
         Shader(const char *vertexShaderSource, const char *fragmentShaderSource);
 
         // Sets the active OpenGL shader to this shader program. This needs to
         // be done before drawing an object each time one's rendered.
         void use();
 
-        // Allows setting integer uniform values for the shader.
+        // Returns the OpenGL id of the shader program.
+        unsigned int getProgram() const;
+
+        // Returns a handle to an active uniform, or an invalid handle if the
+        // program has no active uniform with that name. Resolve handles once
+        // and reuse them instead of setting uniforms by name every frame.
+        UniformHandle getUniform(const char *uniform) const;
+
+        // Allows setting integer uniform values for the shader. Uploads are
+        // skipped when the value hasn't changed since the last set, and the
+        // shader is made current first if it isn't already. Invalid handles
+        // and unknown names are ignored.
+        void setUniformInt(UniformHandle uniform, int value);
         void setUniformInt(const char *uniform, int value);
 
-        // Allows setting mat4 uniforms for the shader.
-        void setUniformMat4(const char *uniform, float *value);
+        // Allows setting mat4 uniforms for the shader. Behaves the same way
+        // as setUniformInt.
+        void setUniformMat4(UniformHandle uniform, const float *value);
+        void setUniformMat4(const char *uniform, const float *value);
+
+        // Returns the number of uniform uploads issued and the number skipped
+        // because the value was already set.
+        std::size_t getUniformUploads() const;
+        std::size_t getSkippedUniformUploads() const;
     private:
+        // Active uniform found after linking along with the last value
+        // uploaded to it.
+        struct Uniform {
+            std::string name;
+            int location;
+            unsigned int type;
+            bool cached = false;
+            union {
+                int intValue;
+                float floatValues[16];
+            };
+        };
+
         // OpenGL id for the shader program associated with the shader object.
         unsigned int program;
 
+        // Active uniforms and their indices by name.
+        std::vector<Uniform> uniforms;
+        std::unordered_map<std::string, int> uniformIndices;
+
+        std::size_t uniformUploads = 0;
+        std::size_t skippedUniformUploads = 0;
+
+        // Shader program most recently made current through any Shader, used
+        // to avoid redundant glUseProgram calls when setting uniforms.
+        static unsigned int currentProgram;
+
+        // Queries the active uniforms of the linked program.
+        void introspectUniforms();
+
+        // Makes the shader current if it isn't already.
+        void ensureCurrent();
+
         // Compiles shader source of of a specified type and returns an OpenGL
         // id pointing to the unlinked shader. This function can throw a
         // ShaderCompilationError if the source code is malformed.
@@ -44,7 +111,9 @@ namespace scenegraphdemo {
         // Links a vertex and fragment shader into an OpenGL shader program.
         // This function will throw a ShaderLinkingError should it fail. This
         // function will also delete the shaders passed into it once linking is
-        // finished (or has failed).
-        unsigned int linkProgram(unsigned int vertexShader, unsigned int fragmentShader);
+        // finished (or has failed). Retrievable programs can have their
+        // binary cached with glGetProgramBinary.
+        unsigned int linkProgram(unsigned int vertexShader, unsigned int fragmentShader,
+            bool retrievable = false);
     };
 }
@@ -0,0 +1,141 @@
+#include "threading/thread_pool.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace scenegraphdemo {
+    // Pool and worker index of the current thread, used to route tasks
+    // submitted from inside a task to the submitting worker's deque.
+    static thread_local ThreadPool *currentPool = nullptr;
+    static thread_local std::size_t currentWorker = 0;
+
+    ThreadPool::ThreadPool(std::size_t threadCount) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        for (std::size_t i = 0; i < threadCount; i++) {
+            workers.emplace_back(new Worker());
+        }
+        for (std::size_t i = 0; i < threadCount; i++) {
+            threads.emplace_back(&ThreadPool::work, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        sleepCondition.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    std::size_t ThreadPool::size() const {
+        return workers.size();
+    }
+
+    void ThreadPool::submit(TaskGroup &group, std::function<void()> task) {
+        group.pending.fetch_add(1, std::memory_order_relaxed);
+
+        std::size_t index;
+        if (currentPool == this) {
+            index = currentWorker;
+        } else {
+            index = nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+        }
+        {
+            std::lock_guard<std::mutex> lock(workers[index]->mutex);
+            workers[index]->tasks.push_back(Task{std::move(task), &group});
+        }
+        queued.fetch_add(1, std::memory_order_release);
+
+        // Taking the sleep mutex orders the increment above with workers
+        // checking it before going to sleep, so the wakeup can't be lost.
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        sleepCondition.notify_one();
+    }
+
+    void ThreadPool::wait(TaskGroup &group) {
+        std::size_t index = currentPool == this ? currentWorker : workers.size();
+        while (group.pending.load(std::memory_order_acquire) > 0) {
+            Task task;
+            if (findTask(index, task)) {
+                run(task);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+
+        // Every task is done, so the failure can be taken without the lock
+        // and the group is ready to be reused.
+        if (group.failure) {
+            std::exception_ptr failure = std::move(group.failure);
+            group.failure = nullptr;
+            std::rethrow_exception(failure);
+        }
+    }
+
+    void ThreadPool::work(std::size_t index) {
+        currentPool = this;
+        currentWorker = index;
+
+        while (true) {
+            Task task;
+            if (findTask(index, task)) {
+                run(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCondition.wait(lock, [this] {
+                return stopping || queued.load(std::memory_order_acquire) > 0;
+            });
+            if (stopping && queued.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+        }
+    }
+
+    bool ThreadPool::findTask(std::size_t index, Task &task) {
+        if (index < workers.size()) {
+            Worker &own = *workers[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        // Steal the oldest task of another worker, as it's likely the largest
+        // piece of recursively split work.
+        for (std::size_t i = 1; i <= workers.size(); i++) {
+            Worker &victim = *workers[(index + i) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::run(Task &task) {
+        try {
+            task.function();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(task.group->mutex);
+            if (!task.group->failure) {
+                task.group->failure = std::current_exception();
+            }
+        }
+        task.group->pending.fetch_sub(1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace scenegraphdemo {
+    // Counter of unfinished tasks that a caller can wait on.
+    struct TaskGroup {
+        std::atomic<std::size_t> pending{0};
+
+        // First exception thrown by a task of the group, rethrown by wait.
+        std::mutex mutex;
+        std::exception_ptr failure;
+    };
+
+    // Fixed-size pool of worker threads with one task deque per worker.
+    // Workers pop their own newest tasks first and steal the oldest tasks of
+    // other workers when they run dry, which keeps recursively split work
+    // local while still balancing it across the pool.
+    class ThreadPool {
+    public:
+        // Starts the pool with the given number of workers. Passing zero uses
+        // one worker per hardware thread.
+        ThreadPool(std::size_t threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // Returns the number of worker threads.
+        std::size_t size() const;
+
+        // Queues a task as part of a group. Tasks submitted from a worker go
+        // onto that worker's own deque.
+        void submit(TaskGroup &group, std::function<void()> task);
+
+        // Blocks until every task of the group finished. The calling thread
+        // runs queued tasks while it waits instead of idling. If any task of
+        // the group threw, the first exception is rethrown once all of them
+        // are done, so none is left pointing at the group.
+        void wait(TaskGroup &group);
+    private:
+        struct Task {
+            std::function<void()> function;
+            TaskGroup *group;
+        };
+
+        struct Worker {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::thread> threads;
+
+        // Number of tasks sitting in any deque, used to put idle workers to
+        // sleep.
+        std::atomic<std::size_t> queued{0};
+
+        // Round-robin cursor for tasks submitted from outside the pool.
+        std::atomic<std::size_t> nextWorker{0};
+
+        std::mutex sleepMutex;
+        std::condition_variable sleepCondition;
+        bool stopping = false;
+
+        // Main loop of worker threads.
+        void work(std::size_t index);
+
+        // Takes a task from the worker's own deque, or steals one from
+        // another worker. The index may be out of range for threads that
+        // aren't part of the pool, in which case only stealing is attempted.
+        bool findTask(std::size_t index, Task &task);
+
+        // Runs a task and signals its group. Exceptions are stored in the
+        // group rather than let out of the worker.
+        void run(Task &task);
+    };
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+
+namespace scenegraphdemo {
+    // Three copies of a value shared by one writer thread and one reader
+    // thread without locks. The writer fills its own copy and publishes it by
+    // swapping it with the middle copy, and the reader swaps its own copy
+    // with the middle one whenever a fresher one was published. Neither side
+    // ever waits on the other or sees a copy that's being written.
+    template<typename T>
+    class TripleBuffer {
+    public:
+        TripleBuffer() : middle(1) {
+        }
+
+        TripleBuffer(const TripleBuffer &) = delete;
+        TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+        // Returns the copy the writer fills. It keeps its contents from the
+        // last time the writer had it, so storage can be reused.
+        T &getWriteBuffer() {
+            return this->buffers[this->back];
+        }
+
+        // Makes the write buffer the latest copy. Writer only.
+        void publish() {
+            this->back = this->middle.exchange(this->back | FRESH, std::memory_order_acq_rel) & INDEX;
+        }
+
+        // Takes the latest published copy if there's one the reader hasn't
+        // seen yet, and returns whether there was. Reader only.
+        bool update() {
+            if ((this->middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+                return false;
+            }
+            this->front = this->middle.exchange(this->front, std::memory_order_acq_rel) & INDEX;
+            return true;
+        }
+
+        // Returns the copy the reader took last.
+        const T &getReadBuffer() const {
+            return this->buffers[this->front];
+        }
+    private:
+        // The middle index is stored in the low bits, along with a flag set
+        // while it holds a copy the reader hasn't taken.
+        enum : unsigned int {
+            INDEX = 3,
+            FRESH = 4,
+        };
+
+        T buffers[3];
+        std::atomic<unsigned int> middle;
+        unsigned int back = 0;
+        unsigned int front = 2;
+    };
+}
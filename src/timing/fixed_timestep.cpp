@@ -0,0 +1,49 @@
+#include "timing/fixed_timestep.hpp"
+#include <cmath>
+#include <stdexcept>
+
+namespace scenegraphdemo {
+    FixedTimestep::FixedTimestep(double step, unsigned int maxSteps) {
+        if (!(step > 0.0) || maxSteps == 0) {
+            throw std::runtime_error("Fixed timesteps need a positive step length and step count");
+        }
+        this->step = step;
+        this->maxSteps = maxSteps;
+    }
+
+    unsigned int FixedTimestep::advance(double elapsed) {
+        if (elapsed > 0.0) {
+            this->accumulator += elapsed;
+        }
+
+        const double due = std::floor(this->accumulator / this->step);
+        unsigned int count = this->maxSteps;
+        if (due < this->maxSteps) {
+            count = static_cast<unsigned int>(due);
+        } else {
+            // Only keep the partial step, so the next frame starts fresh.
+            const double kept = std::fmod(this->accumulator, this->step);
+            this->droppedTime += this->accumulator - kept - count * this->step;
+            this->accumulator = kept + count * this->step;
+        }
+        this->accumulator -= count * this->step;
+        this->steps += count;
+        return count;
+    }
+
+    double FixedTimestep::getStep() const {
+        return this->step;
+    }
+
+    float FixedTimestep::getAlpha() const {
+        return static_cast<float>(this->accumulator / this->step);
+    }
+
+    std::uint64_t FixedTimestep::getSteps() const {
+        return this->steps;
+    }
+
+    double FixedTimestep::getDroppedTime() const {
+        return this->droppedTime;
+    }
+}
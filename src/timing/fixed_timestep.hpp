@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+namespace scenegraphdemo {
+    // Turns the real time passing between frames into a whole number of
+    // simulation steps of a fixed length, so the simulation advances the same
+    // way at any frame rate. Time that doesn't add up to a full step is
+    // carried over to the next frame, and the fraction of a step it makes up
+    // is what rendering interpolates by.
+    class FixedTimestep {
+    public:
+        // Creates a scheduler running steps of the given length in seconds.
+        // At most maxSteps are run per frame. Time beyond that is dropped, so
+        // after a long stall the simulation slows down for a moment instead
+        // of spending ever longer frames catching up.
+        FixedTimestep(double step, unsigned int maxSteps);
+
+        // Adds the real time elapsed since the last call, in seconds, and
+        // returns the number of steps to run now.
+        unsigned int advance(double elapsed);
+
+        // Returns the length of a step in seconds.
+        double getStep() const;
+
+        // Returns how far into the next step the accumulated time is, from 0
+        // to 1, as of the last advance.
+        float getAlpha() const;
+
+        // Returns the number of steps handed out so far.
+        std::uint64_t getSteps() const;
+
+        // Returns the seconds of real time dropped by the catch-up cap.
+        double getDroppedTime() const;
+    private:
+        double step;
+        unsigned int maxSteps;
+
+        // Time not yet covered by a step.
+        double accumulator = 0.0;
+
+        std::uint64_t steps = 0;
+        double droppedTime = 0.0;
+    };
+}
@@ -0,0 +1,178 @@
+#include "resources/asset_archive.hpp"
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef SCENEGRAPHDEMO_LZ4
+#include <lz4.h>
+#endif
+
+using namespace scenegraphdemo;
+
+// Compressed contents are only kept when they're at most this fraction of the
+// original size, since reading them costs a decompression.
+constexpr double MAX_COMPRESSION_RATIO = 0.9;
+
+// File to pack along with its path inside the archive.
+struct InputFile {
+    boost::filesystem::path source;
+    std::string path;
+    std::uint64_t hash;
+};
+
+// Prints how to invoke the packer.
+void printUsage(const char *program) {
+    std::cerr << "Usage: " << program << " [--no-compress] <asset-dir> <archive>" << std::endl;
+}
+
+// Collects every regular file below a directory, sorted by path hash as the
+// archive index requires.
+std::vector<InputFile> collectFiles(const boost::filesystem::path &root) {
+    std::vector<InputFile> files;
+    for (boost::filesystem::recursive_directory_iterator it(root), end; it != end; ++it) {
+        if (!boost::filesystem::is_regular_file(it->status())) {
+            continue;
+        }
+        InputFile file;
+        file.source = it->path();
+        file.path = it->path().lexically_relative(root).generic_string();
+        file.hash = hashAssetPath(file.path);
+        files.push_back(file);
+    }
+    std::sort(files.begin(), files.end(), [](const InputFile &a, const InputFile &b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.path < b.path;
+    });
+    return files;
+}
+
+// Reads a whole file into memory.
+std::vector<char> readFile(const boost::filesystem::path &path) {
+    std::ifstream file(path.string(), std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open file: " + path.string());
+    }
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Pads the output with zeros up to the next multiple of alignment.
+void pad(std::ofstream &out, std::uint64_t &offset, std::size_t alignment) {
+    while (offset % alignment != 0) {
+        out.put('\0');
+        offset++;
+    }
+}
+
+// Writes the archive and returns the number of entries that were compressed.
+std::size_t writeArchive(
+        const std::vector<InputFile> &files,
+        const std::string &filename,
+        bool compress) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create archive: " + filename);
+    }
+
+    // The header is rewritten once every offset is known.
+    ArchiveHeader header = {};
+    std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    header.version = ARCHIVE_VERSION;
+    header.entryCount = files.size();
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    std::uint64_t offset = sizeof(header);
+
+    std::vector<ArchiveEntry> entries;
+    std::string paths;
+    std::size_t compressed = 0;
+    for (const auto &file : files) {
+        std::vector<char> contents = readFile(file.source);
+
+        ArchiveEntry entry = {};
+        entry.pathHash = file.hash;
+        entry.size = contents.size();
+        entry.pathOffset = paths.size();
+        entry.pathLength = file.path.size();
+        entry.compression = ArchiveCompression::NONE;
+        paths += file.path;
+
+#ifdef SCENEGRAPHDEMO_LZ4
+        if (compress && !contents.empty()) {
+            std::vector<char> packed(LZ4_compressBound(contents.size()));
+            int packedSize = LZ4_compress_default(contents.data(), packed.data(),
+                contents.size(), packed.size());
+            if (packedSize > 0 && packedSize <= contents.size() * MAX_COMPRESSION_RATIO) {
+                packed.resize(packedSize);
+                contents.swap(packed);
+                entry.compression = ArchiveCompression::LZ4;
+                compressed++;
+            }
+        }
+#endif
+
+        pad(out, offset, ARCHIVE_ALIGNMENT);
+        entry.offset = offset;
+        entry.storedSize = contents.size();
+        out.write(contents.data(), contents.size());
+        offset += contents.size();
+
+        // Readers rely on contents being followed by a zero byte.
+        out.put('\0');
+        offset++;
+        entries.push_back(entry);
+    }
+
+    pad(out, offset, alignof(ArchiveEntry));
+    header.indexOffset = offset;
+    out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(ArchiveEntry));
+    offset += entries.size() * sizeof(ArchiveEntry);
+
+    header.pathsOffset = offset;
+    out.write(paths.data(), paths.size());
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (!out) {
+        throw std::runtime_error("Cannot write archive: " + filename);
+    }
+    return compressed;
+}
+
+// Packs a directory of assets into a single archive that the demo can mount
+// in place of the directory.
+int main(int argc, char **argv) {
+    bool compress = true;
+    std::vector<std::string> arguments;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--no-compress") == 0) {
+            compress = false;
+        } else {
+            arguments.push_back(argv[i]);
+        }
+    }
+    if (arguments.size() != 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+#ifndef SCENEGRAPHDEMO_LZ4
+    if (compress) {
+        std::cerr << "LZ4 support isn't built in, so files are stored uncompressed" << std::endl;
+    }
+#endif
+
+    try {
+        auto files = collectFiles(arguments[0]);
+        auto compressed = writeArchive(files, arguments[1], compress);
+        std::cout << "Packed " << files.size() << " files (" << compressed
+            << " compressed) into " << arguments[1] << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}